@@ -0,0 +1,310 @@
+#include <GaRight/BatchEvaluator.h>
+#include <GaRight/EvaluationBatch.h>
+#include <GaRight/EvaluationVerifier.h>
+#include <GaRight/Individual.h>
+#include <GaRight/ParallelEvaluator.h>
+#include <GaRight/PopulationSeeding.h>
+#include <GaRight/SimulatedAnnealing.h>
+#include <GaRight/Topology.h>
+#include <GaRight/TopologyInputGenerator.h>
+#include <GaRight/TrafficDelta.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+  /// Randomised topology input together with configurations to evaluate.
+  struct StressCase final {
+    TopologyInput input;
+    std::vector<TopologyConfiguration> configurations;
+    std::string description;
+  };
+
+  StressCase CreateCase(uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::ostringstream description;
+
+    // Shape. Routers beyond hosts always leave empty subnetworks
+    size_t hosts = 1 + rng() % 48;
+    size_t routers = 1 + rng() % 24;
+    switch (rng() % 8) {
+      case 0:
+        routers = hosts;
+        break;
+      case 1:
+        routers = 1;
+        break;
+      case 2:
+        hosts = 1;
+        break;
+      case 3:
+        routers = hosts + 1 + rng() % 8;
+        break;
+      case 4:
+        if (rng() % 16 == 0) {
+          hosts = ParallelEvaluator::kMinHosts + rng() % 64;
+          routers = 2 + rng() % 20;
+        }
+        break;
+      case 5:
+        if (rng() % 16 == 0) {
+          routers = ParallelEvaluator::kMinRouters + rng() % 16;
+        }
+        break;
+      default:
+        break;
+    }
+    description << "hosts " << hosts << ", routers " << routers;
+
+    const double chances[] = { 0.0, 0.1, 0.5, 1.0 };
+    double nonZeroChance = chances[rng() % 4];
+    description << ", traffic density " << nonZeroChance;
+
+    std::vector<size_t> portsCount(routers);
+    for (auto& ports : portsCount) {
+      ports = rng() % (2 * hosts / routers + 2);
+    }
+
+    StressCase result {
+      TopologyInput {
+        hosts,
+        routers,
+        std::move(portsCount),
+        TopologyInputGenerator::CreateTrafficMatrix(hosts, { nonZeroChance, 4500, 500 }, rng(), 1 + rng() % 4),
+        TopologyInputGenerator::CreateBandwidthMatrix(routers, { 50000, 30000 }, rng())
+      },
+      {},
+      {}
+    };
+    TopologyInput& input = result.input;
+
+    if (rng() % 3 == 0) {
+      uint64_t layoutSeed = rng();
+      input.hostUnits = TopologyInputGenerator::CreateHostUnits(input.trafficMatrix, { 100.0f, 100.0f }, layoutSeed);
+      input.routerUnits = TopologyInputGenerator::CreateRouterUnits(input.bandwidthMatrix, { 100.0f, 100.0f }, layoutSeed);
+      input.candidates = CandidateTable::Create(input.hostUnits, input.routerUnits, 1 + rng() % 3);
+      description << ", layout";
+    }
+
+    if (rng() % 3 == 0 && hosts < ParallelEvaluator::kMinHosts) {
+      std::vector<Matrix<size_t>> epochs;
+      for (size_t i = 0, count = 2 + rng() % 3; i < count; ++i) {
+        epochs.emplace_back(TopologyInputGenerator::CreateTrafficMatrix(hosts, { nonZeroChance, 4500, 500 }, rng(), 1));
+      }
+      auto aggregation = static_cast<EpochAggregation>(rng() % 3);
+      input.SetTrafficEpochs(epochs, aggregation, 0.5);
+      description << ", " << epochs.size() << " epochs aggregated by " << static_cast<int>(aggregation);
+    }
+
+    // Configurations: router types all HUB, all SWITCH or mixed; hosts spread, packed into a few routers or into one
+    size_t configurations = hosts < ParallelEvaluator::kMinHosts ? 1 + rng() % 6 : 1;
+    for (size_t i = 0; i < configurations; ++i) {
+      TopologyConfiguration conf;
+      size_t typeMode = rng() % 3;
+      for (size_t router = 0; router < routers; ++router) {
+        conf.routerTypeTable.emplace_back(typeMode == 0 ? RouterType::HUB : typeMode == 1 ? RouterType::SWITCH : static_cast<RouterType>(rng() % 2));
+      }
+
+      size_t usedRouters = rng() % 3 == 0 ? 1 + rng() % routers : routers;
+      for (size_t host = 0; host < hosts; ++host) {
+        conf.membershipTable.emplace_back(rng() % usedRouters);
+      }
+      result.configurations.emplace_back(std::move(conf));
+    }
+
+    result.description = description.str();
+    return result;
+  }
+
+  /**
+   * Compares loads and objectives kept incrementally by every chain with the reference ones. Returns the first diff, empty if everything matches.
+   */
+  std::string VerifyChains(const TopologyInput& input, const SimulatedAnnealing& annealing) {
+    for (size_t chain = 0; chain < annealing.GetChainsCount(); ++chain) {
+      TopologyConfiguration conf = annealing.CreateChainConfiguration(chain);
+      Objectives objectives = annealing.GetChainObjectives(chain);
+      // Distance is summed in another order, so it and the chain's fitness may differ by rounding
+      double distance = input.CalculateDistance(conf.membershipTable);
+      if (std::abs(objectives.distance - distance) > 1e-9 * std::max(distance, 1.0)) {
+        return std::to_string(chain) + ":\n  distance: " + std::to_string(objectives.distance) + ", expected " + std::to_string(distance) + '\n';
+      }
+      objectives.distance = distance;
+      double fitness = Individual::CalculateFitness(input, objectives);
+      double chainFitness = annealing.GetChainFitness(chain);
+      if (chainFitness != fitness && std::abs(chainFitness - fitness) > 1e-9 * fitness) {
+        return std::to_string(chain) + ":\n  fitness: " + std::to_string(chainFitness) + ", expected " + std::to_string(fitness) + '\n';
+      }
+
+      std::string diff = EvaluationVerifier::Compare(input, conf, objectives, fitness);
+      if (!diff.empty()) {
+        return std::to_string(chain) + ":\n" + diff;
+      }
+    }
+
+    return {};
+  }
+
+  /**
+   * Evaluates all configurations of the case by every fast path. Returns the first diff, empty if everything matches.
+   */
+  std::string RunCase(StressCase& stressCase, uint64_t seed) {
+    TopologyInput& input = stressCase.input;
+    std::mt19937_64 rng(seed ^ 0x5DEECE66DULL);
+
+    // Single configuration path: kernels, parallel or sequential load matrix
+    for (auto& conf : stressCase.configurations) {
+      conf.Update(input);
+      Objectives objectives = Individual::CalculateObjectives(input, conf);
+      std::string diff = EvaluationVerifier::Compare(input, conf, objectives, Individual::CalculateFitness(input, objectives));
+      if (!diff.empty()) {
+        return "Update:\n" + diff;
+      }
+    }
+
+    // Batch path
+    EvaluationBatch batch;
+    batch.Resize(stressCase.configurations.size(), input.hosts, input.routers, input.epochs.IsPerEpoch() ? input.epochs.count : 0);
+    for (size_t i = 0; i < batch.count; ++i) {
+      batch.Store(i, stressCase.configurations[i].membershipTable, stressCase.configurations[i].routerTypeTable);
+    }
+    BatchEvaluator::Evaluate(input, batch);
+    for (size_t i = 0; i < batch.count; ++i) {
+      TopologyConfiguration conf = stressCase.configurations[i];
+      conf.channelLoadMatrix.Assign(batch.GetLoads(i));
+      std::string diff = EvaluationVerifier::Compare(input, conf, batch.objectives[i], Individual::CalculateFitness(input, batch.objectives[i]));
+      if (!diff.empty()) {
+        return "BatchEvaluator:\n" + diff;
+      }
+    }
+
+    // Parallel path with an odd number of threads. Many threads over many routers split flows by router slices
+    for (auto conf : stressCase.configurations) {
+      size_t threads = 1 + rng() % 24;
+      ParallelEvaluator::FillLoadMatrix(input, conf.membershipTable, conf.routerTypeTable, conf.channelLoadMatrix, threads);
+      Objectives objectives = Individual::CalculateObjectives(input, conf);
+      objectives.values[0] = ParallelEvaluator::CalculateTrafficDifference(input, conf.channelLoadMatrix, threads);
+      if (input.epochs.IsPerEpoch()) {
+        EpochEvaluator::Evaluate(input, conf.membershipTable, conf.routerTypeTable, objectives);
+      }
+      std::string diff = EvaluationVerifier::Compare(input, conf, objectives, Individual::CalculateFitness(input, objectives));
+      if (!diff.empty()) {
+        return "ParallelEvaluator with " + std::to_string(threads) + " threads:\n" + diff;
+      }
+    }
+
+    // Seeded population: hosts stay on their candidate routers unless all of them are full
+    if (!input.candidates.IsEmpty()) {
+      TopologyRandom random { std::mt19937_64(rng()), {} };
+      for (const auto& individual : PopulationSeeding::CreatePopulation(input, random, 4, { 1.0, 0.05 })) {
+        const TopologyConfiguration& conf = individual.GetConfiguration();
+        std::vector<size_t> hostsCount(input.routers, 0);
+        for (size_t router : conf.membershipTable) {
+          ++hostsCount[router];
+        }
+        for (size_t host = 0; host < input.hosts; ++host) {
+          auto candidates = input.candidates.Get(host);
+          bool full = std::ranges::all_of(candidates, [&](size_t router) { return hostsCount[router] >= input.portsCount[router]; });
+          if (!full && std::ranges::find(candidates, conf.membershipTable[host]) == candidates.end()) {
+            return "PopulationSeeding: host " + std::to_string(host) + " is outside of its candidates with free ports\n";
+          }
+        }
+
+        std::string diff = EvaluationVerifier::Compare(input, conf, individual.GetObjectives(), individual.GetFitness());
+        if (!diff.empty()) {
+          return "PopulationSeeding:\n" + diff;
+        }
+      }
+    }
+
+    // Annealing moves: loads and objectives kept incrementally by chains. Chains score the mean traffic, so epochs are skipped
+    if (!input.epochs.IsPerEpoch()) {
+      SimulatedAnnealing::Options options;
+      options.chains = 3;
+      options.steps = 400;
+      options.exchangeInterval = 1 + rng() % 200;
+      options.typeFlipShare = 0.2;
+      options.seed = rng();
+      SimulatedAnnealing annealing(input, options);
+      std::string diff = VerifyChains(input, annealing);
+      while (diff.empty() && annealing.GetSteps() < options.steps) {
+        annealing.Step();
+        diff = VerifyChains(input, annealing);
+      }
+      if (!diff.empty()) {
+        return "SimulatedAnnealing after " + std::to_string(annealing.GetSteps()) + " steps, chain " + diff;
+      }
+    }
+
+    // Incremental path after traffic changes, including removed and added traffic. With epochs, entries of random epochs change
+    Matrix<size_t> traffic = input.trafficMatrix;
+    std::vector<Matrix<size_t>> epochs;
+    for (size_t epoch = 0; epoch < input.epochs.count; ++epoch) {
+      epochs.emplace_back(input.epochs.CreateMatrix(epoch, input.hosts));
+    }
+    for (size_t i = 0, count = rng() % 8; i < count && input.hosts != 0; ++i) {
+      Matrix<size_t>& target = epochs.empty() ? traffic : epochs[rng() % epochs.size()];
+      target.At(rng() % input.hosts, rng() % input.hosts) = rng() % 2 == 0 ? 0 : rng() % 9000;
+    }
+    TrafficDelta delta = epochs.empty()
+      ? TrafficDelta::Create(input.trafficMatrix, traffic)
+      : TrafficDelta::Create(input.trafficMatrix, TrafficEpochs::CreateMeanMatrix(epochs), input.epochs, TrafficEpochs::Create(epochs, input.epochs.aggregation, input.epochs.percentile));
+
+    // Reference reads traffic set directly, so stale epochs of the updated input can't match it
+    TopologyInput expected = input;
+    if (epochs.empty()) {
+      expected.trafficMatrix = std::move(traffic);
+    }
+    else {
+      expected.SetTrafficEpochs(epochs, input.epochs.aggregation, input.epochs.percentile);
+    }
+    input.ApplyTrafficDelta(delta);
+    for (auto& conf : stressCase.configurations) {
+      conf.ApplyTrafficDelta(input, delta);
+      Objectives objectives = Individual::CalculateObjectives(input, conf);
+      std::string diff = EvaluationVerifier::Compare(expected, conf, objectives, Individual::CalculateFitness(input, objectives));
+      if (!diff.empty()) {
+        return "ApplyTrafficDelta with " + std::to_string(delta.changes.size()) + " changes, " + std::to_string(delta.epochChanges.size()) + " epoch changes:\n" + diff;
+      }
+    }
+
+    return {};
+  }
+
+  bool ParseNumber(std::string_view text, uint64_t& value) {
+    auto [last, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && last == text.data() + text.size();
+  }
+}
+
+// Compares every fast evaluation path with the reference one on randomised inputs, edge cases included.
+// Also checks that seeded populations respect candidate routers and that annealing chains keep their evaluation.
+int main(int argc, char** argv) {
+  uint64_t iterations = 1000;
+  uint64_t seed = std::random_device()();
+  if ((argc > 1 && !ParseNumber(argv[1], iterations)) || (argc > 2 && !ParseNumber(argv[2], seed))) {
+    std::cerr << "Usage: EvaluatorStress [iterations] [seed]\n";
+    return 1;
+  }
+
+  std::cout << "Seed " << seed << '\n';
+  for (uint64_t i = 0; i < iterations; ++i) {
+    uint64_t caseSeed = seed + i;
+    StressCase stressCase = CreateCase(caseSeed);
+    std::string diff = RunCase(stressCase, caseSeed);
+    if (!diff.empty()) {
+      std::cerr << "Case " << caseSeed << " (" << stressCase.description << ") failed. " << diff;
+      return 1;
+    }
+  }
+
+  std::cout << iterations << " cases passed\n";
+  return 0;
+}
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+enum class NodeType {
+  CONSTANT,
+  VARIABLE,
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  POW,
+  NEG,
+  SIN,
+  COS,
+  EXP,
+  LOG,
+  SQRT,
+  ABS,
+  /// -1, 0 or 1. Appears only in derivatives of abs
+  SIGN
+};
+
+/**
+ * Immutable expression tree of a single variable x. Subtrees are shared, so derivatives reuse the original expression.
+ */
+struct ExpressionNode final {
+  NodeType type;
+  float value;
+  std::shared_ptr<const ExpressionNode> lhs;
+  std::shared_ptr<const ExpressionNode> rhs;
+};
+
+using Expression = std::shared_ptr<const ExpressionNode>;
+
+/**
+ * Contains parsing, simplifying constructors and symbolic differentiation of expressions.
+ * Grammar: sum = product (('+' | '-') product)*, product = unary (('*' | '/') unary)*,
+ * unary = '-' unary | power, power = primary ('^' unary)?, primary = number | 'x' | function '(' sum ')' | '(' sum ')'.
+ * Unary minus binds looser than '^', so -x^2 is -(x^2) and 2^-x is 2^(-x).
+ * Functions: sin, cos, exp, log, sqrt, abs.
+ */
+struct Expressions final {
+  static Expression Constant(float value) {
+    return std::make_shared<const ExpressionNode>(ExpressionNode { NodeType::CONSTANT, value, nullptr, nullptr });
+  }
+
+  static Expression Variable() {
+    return std::make_shared<const ExpressionNode>(ExpressionNode { NodeType::VARIABLE, 0.0f, nullptr, nullptr });
+  }
+
+  /**
+   * Creates a node, folding constants and dropping neutral elements.
+   */
+  static Expression Create(NodeType type, Expression lhs, Expression rhs = nullptr) {
+    bool constant = lhs->type == NodeType::CONSTANT && (!rhs || rhs->type == NodeType::CONSTANT);
+    if (constant) {
+      return Constant(Apply(type, lhs->value, rhs ? rhs->value : 0.0f));
+    }
+
+    auto is = [](const Expression& node, float value) {
+      return node && node->type == NodeType::CONSTANT && node->value == value;
+    };
+    switch (type) {
+      case NodeType::ADD:
+        if (is(lhs, 0.0f)) {
+          return rhs;
+        }
+        if (is(rhs, 0.0f)) {
+          return lhs;
+        }
+        break;
+      case NodeType::SUB:
+        if (is(rhs, 0.0f)) {
+          return lhs;
+        }
+        if (is(lhs, 0.0f)) {
+          return Create(NodeType::NEG, rhs);
+        }
+        break;
+      case NodeType::MUL:
+        if (is(lhs, 0.0f) || is(rhs, 0.0f)) {
+          return Constant(0.0f);
+        }
+        if (is(lhs, 1.0f)) {
+          return rhs;
+        }
+        if (is(rhs, 1.0f)) {
+          return lhs;
+        }
+        break;
+      case NodeType::DIV:
+        if (is(rhs, 1.0f)) {
+          return lhs;
+        }
+        break;
+      case NodeType::POW:
+        if (is(rhs, 1.0f)) {
+          return lhs;
+        }
+        if (is(rhs, 0.0f)) {
+          return Constant(1.0f);
+        }
+        break;
+      case NodeType::NEG:
+        if (lhs->type == NodeType::NEG) {
+          return lhs->lhs;
+        }
+        break;
+      default:
+        break;
+    }
+
+    return std::make_shared<const ExpressionNode>(ExpressionNode { type, 0.0f, std::move(lhs), std::move(rhs) });
+  }
+
+  /**
+   * Parses text into result. Returns false and describes the problem in error on failure.
+   */
+  static bool Parse(std::string_view text, Expression& result, std::string& error) {
+    Parser parser { text, 0, {} };
+    result = parser.ParseSum();
+    if (result && parser.Skip() && parser.position != text.size()) {
+      parser.Fail("unexpected character");
+    }
+    if (!parser.error.empty()) {
+      error = parser.error;
+      result = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Returns d(expression)/dx.
+   */
+  static Expression Derive(const Expression& e) {
+    const Expression& u = e->lhs;
+    const Expression& v = e->rhs;
+    switch (e->type) {
+      case NodeType::CONSTANT:
+        return Constant(0.0f);
+      case NodeType::VARIABLE:
+        return Constant(1.0f);
+      case NodeType::ADD:
+      case NodeType::SUB:
+        return Create(e->type, Derive(u), Derive(v));
+      case NodeType::MUL:
+        return Create(NodeType::ADD, Create(NodeType::MUL, Derive(u), v), Create(NodeType::MUL, u, Derive(v)));
+      case NodeType::DIV:
+        return Create(NodeType::DIV,
+          Create(NodeType::SUB, Create(NodeType::MUL, Derive(u), v), Create(NodeType::MUL, u, Derive(v))),
+          Create(NodeType::MUL, v, v));
+      case NodeType::POW:
+        if (v->type == NodeType::CONSTANT) {
+          // c * u^(c - 1) * u'
+          return Create(NodeType::MUL, Create(NodeType::MUL, v, Create(NodeType::POW, u, Constant(v->value - 1.0f))), Derive(u));
+        }
+        // u^v * (v' * ln(u) + v * u' / u)
+        return Create(NodeType::MUL, e, Create(NodeType::ADD,
+          Create(NodeType::MUL, Derive(v), Create(NodeType::LOG, u)),
+          Create(NodeType::DIV, Create(NodeType::MUL, v, Derive(u)), u)));
+      case NodeType::NEG:
+        return Create(NodeType::NEG, Derive(u));
+      case NodeType::SIN:
+        return Create(NodeType::MUL, Create(NodeType::COS, u), Derive(u));
+      case NodeType::COS:
+        return Create(NodeType::NEG, Create(NodeType::MUL, Create(NodeType::SIN, u), Derive(u)));
+      case NodeType::EXP:
+        return Create(NodeType::MUL, e, Derive(u));
+      case NodeType::LOG:
+        return Create(NodeType::DIV, Derive(u), u);
+      case NodeType::SQRT:
+        return Create(NodeType::DIV, Derive(u), Create(NodeType::MUL, Constant(2.0f), e));
+      case NodeType::ABS:
+        return Create(NodeType::MUL, Create(NodeType::SIGN, u), Derive(u));
+      default:
+        return Constant(0.0f);
+    }
+  }
+
+  /**
+   * Applies operation to values. Single source of semantics for folding, reference evaluation and the bytecode.
+   */
+  static float Apply(NodeType type, float lhs, float rhs) {
+    switch (type) {
+      case NodeType::ADD:
+        return lhs + rhs;
+      case NodeType::SUB:
+        return lhs - rhs;
+      case NodeType::MUL:
+        return lhs * rhs;
+      case NodeType::DIV:
+        return lhs / rhs;
+      case NodeType::POW:
+        return std::pow(lhs, rhs);
+      case NodeType::NEG:
+        return -lhs;
+      case NodeType::SIN:
+        return std::sin(lhs);
+      case NodeType::COS:
+        return std::cos(lhs);
+      case NodeType::EXP:
+        return std::exp(lhs);
+      case NodeType::LOG:
+        return std::log(lhs);
+      case NodeType::SQRT:
+        return std::sqrt(lhs);
+      case NodeType::ABS:
+        return std::abs(lhs);
+      case NodeType::SIGN:
+        return static_cast<float>((lhs > 0.0f) - (lhs < 0.0f));
+      default:
+        return lhs;
+    }
+  }
+
+  /**
+   * Evaluates the tree at x. Slow, used as reference.
+   */
+  static float Evaluate(const Expression& e, float x) {
+    switch (e->type) {
+      case NodeType::CONSTANT:
+        return e->value;
+      case NodeType::VARIABLE:
+        return x;
+      default:
+        return Apply(e->type, Evaluate(e->lhs, x), e->rhs ? Evaluate(e->rhs, x) : 0.0f);
+    }
+  }
+
+  static void Print(std::ostream& os, const Expression& e) {
+    static constexpr const char* kFunctions[] = { "sin", "cos", "exp", "log", "sqrt", "abs", "sign" };
+    static constexpr char kOperators[] = { '+', '-', '*', '/', '^' };
+    switch (e->type) {
+      case NodeType::CONSTANT:
+        os << e->value;
+        break;
+      case NodeType::VARIABLE:
+        os << 'x';
+        break;
+      case NodeType::NEG:
+        os << "-(";
+        Print(os, e->lhs);
+        os << ')';
+        break;
+      case NodeType::ADD:
+      case NodeType::SUB:
+      case NodeType::MUL:
+      case NodeType::DIV:
+      case NodeType::POW:
+        os << '(';
+        Print(os, e->lhs);
+        os << ' ' << kOperators[static_cast<size_t>(e->type) - static_cast<size_t>(NodeType::ADD)] << ' ';
+        Print(os, e->rhs);
+        os << ')';
+        break;
+      default:
+        os << kFunctions[static_cast<size_t>(e->type) - static_cast<size_t>(NodeType::SIN)] << '(';
+        Print(os, e->lhs);
+        os << ')';
+        break;
+    }
+  }
+
+private:
+  struct Parser final {
+    std::string_view text;
+    size_t position;
+    std::string error;
+
+    /**
+     * Skips whitespace. Returns false if parsing already failed.
+     */
+    bool Skip() {
+      while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+        ++position;
+      }
+      return error.empty();
+    }
+
+    bool Consume(char c) {
+      if (Skip() && position < text.size() && text[position] == c) {
+        ++position;
+        return true;
+      }
+      return false;
+    }
+
+    Expression Fail(std::string_view message) {
+      if (error.empty()) {
+        error = std::string(message) + " at " + std::to_string(position);
+      }
+      return nullptr;
+    }
+
+    Expression ParseSum() {
+      Expression result = ParseProduct();
+      while (result) {
+        if (Consume('+')) {
+          Expression rhs = ParseProduct();
+          result = rhs ? Create(NodeType::ADD, result, rhs) : nullptr;
+        }
+        else if (Consume('-')) {
+          Expression rhs = ParseProduct();
+          result = rhs ? Create(NodeType::SUB, result, rhs) : nullptr;
+        }
+        else {
+          break;
+        }
+      }
+      return result;
+    }
+
+    Expression ParseProduct() {
+      Expression result = ParseUnary();
+      while (result) {
+        if (Consume('*')) {
+          Expression rhs = ParseUnary();
+          result = rhs ? Create(NodeType::MUL, result, rhs) : nullptr;
+        }
+        else if (Consume('/')) {
+          Expression rhs = ParseUnary();
+          result = rhs ? Create(NodeType::DIV, result, rhs) : nullptr;
+        }
+        else {
+          break;
+        }
+      }
+      return result;
+    }
+
+    Expression ParseUnary() {
+      if (Consume('-')) {
+        Expression operand = ParseUnary();
+        return operand ? Create(NodeType::NEG, operand) : nullptr;
+      }
+      return ParsePower();
+    }
+
+    Expression ParsePower() {
+      Expression result = ParsePrimary();
+      if (result && Consume('^')) {
+        // Right associative, the exponent may be negated
+        Expression rhs = ParseUnary();
+        result = rhs ? Create(NodeType::POW, result, rhs) : nullptr;
+      }
+      return result;
+    }
+
+    Expression ParsePrimary() {
+      if (!Skip() || position == text.size()) {
+        return Fail("unexpected end");
+      }
+
+      if (Consume('(')) {
+        Expression result = ParseSum();
+        if (result && !Consume(')')) {
+          return Fail("expected ')'");
+        }
+        return result;
+      }
+
+      char c = text[position];
+      if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+        float value = 0.0f;
+        auto [last, code] = std::from_chars(text.data() + position, text.data() + text.size(), value);
+        if (code != std::errc()) {
+          return Fail("invalid number");
+        }
+        position = last - text.data();
+        return Constant(value);
+      }
+
+      size_t begin = position;
+      while (position < text.size() && std::isalpha(static_cast<unsigned char>(text[position]))) {
+        ++position;
+      }
+      std::string_view name = text.substr(begin, position - begin);
+      if (name == "x") {
+        return Variable();
+      }
+
+      static constexpr std::string_view kFunctions[] = { "sin", "cos", "exp", "log", "sqrt", "abs" };
+      for (size_t i = 0; i < std::size(kFunctions); ++i) {
+        if (name == kFunctions[i]) {
+          if (!Consume('(')) {
+            return Fail("expected '('");
+          }
+          Expression argument = ParseSum();
+          if (argument && !Consume(')')) {
+            return Fail("expected ')'");
+          }
+          return argument ? Create(static_cast<NodeType>(static_cast<size_t>(NodeType::SIN) + i), argument) : nullptr;
+        }
+      }
+
+      position = begin;
+      return Fail("unknown name");
+    }
+  };
+};
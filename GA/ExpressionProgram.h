@@ -0,0 +1,233 @@
+#pragma once
+
+#include "Expression.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+/**
+ * Expression compiled to register bytecode, evaluated over batches of x.
+ * Registers are structure-of-arrays blocks of kBlock lanes and every instruction is a plain loop over lanes,
+ * so the interpreter dispatches once per block and the compiler vectorises the arithmetic.
+ * Equal subexpressions are computed once. Register 0 holds x, constants get their own registers filled at compilation,
+ * temporaries are reused once their value is no longer needed.
+ */
+struct ExpressionProgram final {
+  static constexpr size_t kBlock = 256;
+
+  struct Instruction final {
+    NodeType type;
+    uint16_t destination;
+    uint16_t lhs;
+    uint16_t rhs;
+    /// Exponent of POW by a small non-zero integer constant, 0 for other exponents.
+    int32_t exponent;
+  };
+
+  static ExpressionProgram Compile(const Expression& expression) {
+    ExpressionProgram result;
+    Compiler compiler;
+    size_t root = compiler.Add(expression);
+    result.m_constants = std::move(compiler.constants);
+
+    // Registers of values. x and constants are fixed, temporaries are reused after the last use of their value
+    const size_t fixed = 1 + result.m_constants.size();
+    std::vector<size_t> lastUse(compiler.values.size(), 0);
+    for (size_t i = 0; i < compiler.values.size(); ++i) {
+      const auto& value = compiler.values[i];
+      if (value.type != NodeType::VARIABLE && value.type != NodeType::CONSTANT) {
+        lastUse[value.lhs] = i;
+        lastUse[value.rhs] = i;
+      }
+    }
+    lastUse[root] = compiler.values.size();
+
+    std::vector<uint16_t> registers(compiler.values.size(), 0);
+    std::vector<uint16_t> released;
+    result.m_registersCount = fixed;
+    for (size_t i = 0; i < compiler.values.size(); ++i) {
+      const auto& value = compiler.values[i];
+      if (value.type == NodeType::VARIABLE) {
+        continue;
+      }
+      if (value.type == NodeType::CONSTANT) {
+        registers[i] = static_cast<uint16_t>(1 + value.lhs);
+        continue;
+      }
+
+      // Lanes are computed independently, so the destination may be a released operand register
+      for (size_t operand : { value.lhs, value.rhs }) {
+        if (lastUse[operand] == i && registers[operand] >= fixed && std::ranges::find(released, registers[operand]) == released.end()) {
+          released.emplace_back(registers[operand]);
+        }
+      }
+      if (released.empty()) {
+        assert(result.m_registersCount < UINT16_MAX);
+        registers[i] = static_cast<uint16_t>(result.m_registersCount++);
+      }
+      else {
+        registers[i] = released.back();
+        released.pop_back();
+      }
+      result.m_instructions.emplace_back(Instruction { value.type, registers[i], registers[value.lhs], registers[value.rhs], value.exponent });
+    }
+    result.m_result = registers[root];
+
+    result.m_registers.resize(result.m_registersCount * kBlock);
+    for (size_t i = 0; i < result.m_constants.size(); ++i) {
+      std::fill_n(result.m_registers.begin() + (1 + i) * kBlock, kBlock, result.m_constants[i]);
+    }
+    return result;
+  }
+
+  /**
+   * results[i] = f(xs[i]).
+   */
+  void Evaluate(std::span<const float> xs, std::span<float> results) {
+    assert(xs.size() == results.size());
+    for (size_t begin = 0; begin < xs.size(); begin += kBlock) {
+      const size_t count = std::min(kBlock, xs.size() - begin);
+      std::copy_n(xs.begin() + begin, count, m_registers.begin());
+      for (const auto& instruction : m_instructions) {
+        Execute(instruction, count);
+      }
+      std::copy_n(m_registers.begin() + m_result * kBlock, count, results.begin() + begin);
+    }
+  }
+
+  size_t GetInstructionsCount() const {
+    return m_instructions.size();
+  }
+
+  size_t GetRegistersCount() const {
+    return m_registersCount;
+  }
+
+private:
+  static constexpr int32_t kMaxExponent = 4;
+
+  /**
+   * Flattens the tree into values in evaluation order. Equal subtrees, e.g. repeated in derivatives, become a single value.
+   */
+  struct Compiler final {
+    struct Value final {
+      NodeType type;
+      /// Bits of a constant, so that NaN constants compare equal.
+      uint32_t bits;
+      size_t lhs;
+      size_t rhs;
+      int32_t exponent;
+
+      auto operator<=>(const Value&) const = default;
+    };
+
+    std::vector<Value> values;
+    std::vector<float> constants;
+    std::map<Value, size_t> indices;
+
+    size_t Add(const Expression& e) {
+      Value value { e->type, 0, 0, 0, 0 };
+      switch (e->type) {
+        case NodeType::VARIABLE:
+          break;
+        case NodeType::CONSTANT:
+          value.bits = std::bit_cast<uint32_t>(e->value);
+          value.lhs = FindConstant(constants, e->value);
+          if (value.lhs == constants.size()) {
+            constants.emplace_back(e->value);
+          }
+          break;
+        default:
+          value.lhs = Add(e->lhs);
+          if (e->type == NodeType::POW && IsSmallExponent(e->rhs)) {
+            value.exponent = static_cast<int32_t>(e->rhs->value);
+            value.rhs = value.lhs;
+          }
+          else {
+            value.rhs = e->rhs ? Add(e->rhs) : value.lhs;
+          }
+          break;
+      }
+
+      auto [it, inserted] = indices.try_emplace(value, values.size());
+      if (inserted) {
+        values.emplace_back(value);
+      }
+      return it->second;
+    }
+  };
+
+  static size_t FindConstant(const std::vector<float>& constants, float value) {
+    return std::ranges::find(constants, std::bit_cast<uint32_t>(value), [](float constant) { return std::bit_cast<uint32_t>(constant); }) - constants.begin();
+  }
+
+  static bool IsSmallExponent(const Expression& e) {
+    return e->type == NodeType::CONSTANT && e->value != 0.0f && e->value == std::trunc(e->value) && std::abs(e->value) <= kMaxExponent;
+  }
+
+  template <typename Function>
+  void ForLanes(const Instruction& instruction, size_t count, Function&& function) {
+    float* destination = m_registers.data() + instruction.destination * kBlock;
+    const float* lhs = m_registers.data() + instruction.lhs * kBlock;
+    const float* rhs = m_registers.data() + instruction.rhs * kBlock;
+    for (size_t i = 0; i < count; ++i) {
+      destination[i] = function(lhs[i], rhs[i]);
+    }
+  }
+
+  void Execute(const Instruction& instruction, size_t count) {
+    switch (instruction.type) {
+      case NodeType::ADD:
+        return ForLanes(instruction, count, [](float a, float b) { return a + b; });
+      case NodeType::SUB:
+        return ForLanes(instruction, count, [](float a, float b) { return a - b; });
+      case NodeType::MUL:
+        return ForLanes(instruction, count, [](float a, float b) { return a * b; });
+      case NodeType::DIV:
+        return ForLanes(instruction, count, [](float a, float b) { return a / b; });
+      case NodeType::NEG:
+        return ForLanes(instruction, count, [](float a, float) { return -a; });
+      case NodeType::POW:
+        return ExecutePow(instruction, count);
+      case NodeType::SQRT:
+        return ForLanes(instruction, count, [](float a, float) { return std::sqrt(a); });
+      case NodeType::ABS:
+        return ForLanes(instruction, count, [](float a, float) { return std::abs(a); });
+      default:
+        return ForLanes(instruction, count, [type = instruction.type](float a, float b) { return Expressions::Apply(type, a, b); });
+    }
+  }
+
+  void ExecutePow(const Instruction& instruction, size_t count) {
+    switch (instruction.exponent) {
+      case 0:
+        return ForLanes(instruction, count, [](float a, float b) { return std::pow(a, b); });
+      case 2:
+        return ForLanes(instruction, count, [](float a, float) { return a * a; });
+      case 3:
+        return ForLanes(instruction, count, [](float a, float) { return a * a * a; });
+      case 4:
+        return ForLanes(instruction, count, [](float a, float) { return (a * a) * (a * a); });
+      case -1:
+        return ForLanes(instruction, count, [](float a, float) { return 1.0f / a; });
+      case -2:
+        return ForLanes(instruction, count, [](float a, float) { return 1.0f / (a * a); });
+      default: {
+        float exponent = static_cast<float>(instruction.exponent);
+        return ForLanes(instruction, count, [exponent](float a, float) { return std::pow(a, exponent); });
+      }
+    }
+  }
+
+  std::vector<Instruction> m_instructions;
+  std::vector<float> m_constants;
+  std::vector<float> m_registers;
+  size_t m_registersCount = 1;
+  uint16_t m_result = 0;
+};
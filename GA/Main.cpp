@@ -1,24 +1,44 @@
+#include "ExpressionProgram.h"
+
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <random>
+#include <span>
+#include <string>
+#include <string_view>
 #include <Windows.h>
 #include <ConsoleLib/Console.h>
 
-float Function(float x) {
-  x += 3; // Shift 3 left
-  return x * x * x + 3 * x * x - 2;
-}
+// Used when the command line is empty. Derivative zeros: -5 and -3
+constexpr std::string_view kDefaultFunction = "(x + 3)^3 + 3 * (x + 3)^2 - 2";
 
-float Derivative(float x) {
-  // zeros: -5 and -3
-  x += 3; // Shift 3 left
-  return 3 * x * x + 6 * x;
+/**
+ * Fitness of the derivative value. NaN derivatives, of non-finite genomes or outside the domain, get zero, so roulette never selects them.
+ * Zero or underflowed derivative is the extremum itself and gets the maximal fitness.
+ */
+float CalculateFitness(float derivative) {
+  if (std::isnan(derivative)) {
+    return 0.0f;
+  }
+  float fitness = std::abs(1 / derivative);
+  return std::isinf(fitness) ? std::numeric_limits<float>::max() : fitness;
 }
 
-float CalculateFitness(float x) {
-  return std::abs(1 / Derivative(x));
-}
+/// Genome representation.
+enum class Encoding {
+  /// Bits of the float are crossed and flipped. Children may be NaN or infinity
+  BITS,
+  /// Real value within bounds, blend crossover and gaussian mutation. Children are always finite
+  BOUNDED
+};
+
+struct Bounds final {
+  float min;
+  float max;
+};
 
 uint32_t FloatToInt(float v) {
   return *reinterpret_cast<const uint32_t*>(&v);
@@ -31,12 +51,15 @@ float IntToFloat(uint32_t v) {
 struct Individual {
   Individual()
     : m_x { 0 }
-    , m_fitness { CalculateFitness(0) } {
+    , m_fitness { 0 } {
   }
 
+  /**
+   * Fitness is left zero until the population is evaluated.
+   */
   explicit Individual(float x)
     : m_x { x }
-    , m_fitness { CalculateFitness(x) } {
+    , m_fitness { 0 } {
   }
 
   float GetX() const {
@@ -47,6 +70,10 @@ struct Individual {
     return m_fitness;
   }
 
+  void SetFitness(float fitness) {
+    m_fitness = fitness;
+  }
+
   friend std::ostream& operator<<(std::ostream& os, const Individual& obj) {
     return os << "{ x: " << obj.m_x << ", fitness: " << obj.m_fitness << " }";
   }
@@ -89,6 +116,25 @@ struct Individual {
     return Individual { IntToFloat(x1) };
   }
 
+  static Individual CrossBounded(const Individual& v1, const Individual& v2, const Bounds& bounds, std::random_device& device, std::uniform_real_distribution<float>& gen) {
+    // Blend crossover (BLX-0.5)
+    float low = std::min(v1.GetX(), v2.GetX());
+    float range = std::max(v1.GetX(), v2.GetX()) - low;
+    float x = low - 0.5f * range + gen(device) * 2.0f * range;
+    return Individual { std::clamp(x, bounds.min, bounds.max) };
+  }
+
+  static Individual MutateBounded(const Individual& v, float probability, const Bounds& bounds, std::random_device& device, std::uniform_real_distribution<float>& dist) {
+    // Changes as often as the bit mutation flips any of 32 bits
+    float chance = 1.0f - std::pow(1.0f - probability, 32.0f);
+    if (dist(device) > chance) {
+      return v;
+    }
+
+    std::normal_distribution<float> step(0.0f, 0.1f * (bounds.max - bounds.min));
+    return Individual { std::clamp(v.GetX() + step(device), bounds.min, bounds.max) };
+  }
+
 private:
   float m_x;
   float m_fitness;
@@ -101,16 +147,17 @@ struct GreaterFitnessComparator {
 };
 
 std::vector<float> CalculateCumulativeProbabilities(const std::vector<Individual>& population) {
-  float fitnessSum = std::accumulate(population.begin(), population.end(), 0.0f, [](float old, const Individual& v) {
+  // Summed in double, fitness of extrema is the maximal float
+  double fitnessSum = std::accumulate(population.begin(), population.end(), 0.0, [](double old, const Individual& v) {
     return old + v.GetFitness();
   });
 
   std::vector<float> result;
   result.reserve(population.size());
-  float accumulated = 0.0f;
+  double accumulated = 0.0;
   for (const auto& v : population) {
     accumulated += v.GetFitness() / fitnessSum;
-    result.emplace_back(accumulated);
+    result.emplace_back(static_cast<float>(accumulated));
   }
 
   return result;
@@ -134,29 +181,88 @@ std::vector<Individual> RouletteSelect(const std::vector<Individual>& population
   return result;
 }
 
-std::vector<Individual> DoSelection(std::vector<Individual> pool, float probability, std::random_device& device, std::mt19937_64& generator, std::uniform_real_distribution<float>& dist) {
+std::vector<Individual> DoSelection(std::vector<Individual> pool, float probability, Encoding encoding, const Bounds& bounds, std::random_device& device, std::mt19937_64& generator, std::uniform_real_distribution<float>& dist) {
   std::vector<Individual> result;
   result.reserve(pool.size());
   std::ranges::shuffle(pool, generator);
 
+  auto createChild = [&](const Individual& i1, const Individual& i2) {
+    if (encoding == Encoding::BOUNDED) {
+      return Individual::MutateBounded(Individual::CrossBounded(i1, i2, bounds, device, dist), probability, bounds, device, dist);
+    }
+    return Individual::Mutate(Individual::Cross(i1, i2, device, dist), probability, device, dist);
+  };
+
   for (size_t i = 0; i < pool.size(); i += 2) {
     Individual i1 = pool[i];
     Individual i2 = pool[i + 1];
-    result.emplace_back(Individual::Mutate(
-      Individual::Cross(i1, i2, device, dist),
-      probability, device, dist));
-    result.emplace_back(Individual::Mutate(
-      Individual::Cross(i1, i2, device, dist),
-      probability, device, dist));
+    result.emplace_back(createChild(i1, i2));
+    result.emplace_back(createChild(i1, i2));
   }
 
   return result;
 }
 
-// Task: Find x coordinate for any extrema of the function y = (x + 3)^3 + 3(x + 3)^2 - 2.
-int WINAPI wWinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPWSTR, _In_ int) {
+/**
+ * Evaluates derivative of the whole population in one batch and assigns fitness.
+ */
+void EvaluatePopulation(std::vector<Individual>& population, ExpressionProgram& derivative, std::vector<float>& xs, std::vector<float>& values) {
+  xs.resize(population.size());
+  values.resize(population.size());
+  for (size_t i = 0; i < population.size(); ++i) {
+    xs[i] = population[i].GetX();
+  }
+
+  derivative.Evaluate(xs, values);
+  for (size_t i = 0; i < population.size(); ++i) {
+    population[i].SetFitness(CalculateFitness(values[i]));
+  }
+}
+
+/**
+ * Keeps ASCII characters of the command line, expressions need nothing else.
+ */
+std::string ToAscii(std::wstring_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (wchar_t c : text) {
+    result += c < 128 ? static_cast<char>(c) : '?';
+  }
+
+  return result;
+}
+
+// Task: Find x coordinate for any extrema of the function given on the command line, y = (x + 3)^3 + 3(x + 3)^2 - 2 by default.
+int WINAPI wWinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPWSTR commandLine, _In_ int) {
   Console::GetInstance()->RedirectStdHandles();
 
+  // Objective is compiled once, its derivative is found symbolically
+  std::string text = ToAscii(commandLine);
+  if (text.find_first_not_of(' ') == std::string::npos) {
+    text = kDefaultFunction;
+  }
+  Expression function;
+  std::string error;
+  if (!Expressions::Parse(text, function, error)) {
+    std::cout << "Invalid function \"" << text << "\": " << error << '\n';
+    Console::GetInstance()->Pause();
+    return 1;
+  }
+  Expression derivative = Expressions::Derive(function);
+  std::cout << "y = ";
+  Expressions::Print(std::cout, function);
+  std::cout << "\ny' = ";
+  Expressions::Print(std::cout, derivative);
+  std::cout << '\n';
+
+  ExpressionProgram derivativeProgram = ExpressionProgram::Compile(derivative);
+  std::vector<float> xs;
+  std::vector<float> values;
+
+  // Bits of the float by default. BOUNDED keeps children finite and within bounds, which also bound the initial population
+  const Encoding encoding = Encoding::BITS;
+  const Bounds bounds { -100.0f, 100.0f };
+
   std::random_device device;
   std::mt19937_64 generator(device());
   std::uniform_real_distribution<float> distribution;
@@ -168,15 +274,17 @@ int WINAPI wWinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPWSTR, _In_ int) {
   population.reserve(populationSize);
 
   for (size_t i = 0; i < populationSize; ++i) {
-    population.emplace_back((distribution(device) - 0.5f) * 200.0f);
+    population.emplace_back(bounds.min + distribution(device) * (bounds.max - bounds.min));
   }
+  EvaluatePopulation(population, derivativeProgram, xs, values);
   std::ranges::sort(population, GreaterFitnessComparator());
   std::cout << '[' << iteration << "]: " << population[0] << '\n';
 
   do {
     // Roulette select
     std::vector<Individual> pool = RouletteSelect(population, device, distribution);
-    population = DoSelection(pool, 0.05f, device, generator, distribution);
+    population = DoSelection(pool, 0.05f, encoding, bounds, device, generator, distribution);
+    EvaluatePopulation(population, derivativeProgram, xs, values);
     std::ranges::sort(population, GreaterFitnessComparator());
 
     ++iteration;
@@ -0,0 +1,330 @@
+#include <GaRight/ExactSolver.h>
+#include <GaRight/GeneticAlgorithm.h>
+#include <GaRight/Individual.h>
+#include <GaRight/PopulationSeeding.h>
+#include <GaRight/PortDistributor.h>
+#include <GaRight/SimulatedAnnealing.h>
+#include <GaRight/TopologyInputGenerator.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+  /// Instance of the fixed corpus. Small ones are solved exactly, the rest are compared with the best fitness any run found.
+  struct BenchmarkInstance final {
+    size_t hosts;
+    size_t routers;
+    bool exact;
+  };
+
+  constexpr BenchmarkInstance kCorpus[] = {
+    { 8, 3, true },
+    { 10, 3, true },
+    { 12, 3, true },
+    { 10, 4, true },
+    { 12, 4, true },
+    { 40, 6, false },
+    { 120, 10, false },
+    { 400, 16, false }
+  };
+
+  /// Gaps to the reference fitness whose reaching time is reported. 0 is the optimum itself.
+  constexpr double kTargetGaps[] = { 0.05, 0.01, 0.0 };
+
+  /// Genetic algorithm variants switch on one feature each, so its effect can be attributed.
+  enum class Optimizer {
+    GA,
+    GA_SEEDED,
+    GA_ADAPTIVE,
+    SA,
+    COUNT
+  };
+
+  const char* GetName(Optimizer optimizer) {
+    static constexpr const char* kNames[] = { "ga", "ga-seeded", "ga-adaptive", "sa" };
+    return kNames[static_cast<size_t>(optimizer)];
+  }
+
+  /// Configurations an optimizer can reach. Its gaps are measured to the optimum of that space.
+  enum class SearchSpace {
+    UNCONSTRAINED,
+    /// No router has more hosts than ports.
+    PORT_FEASIBLE,
+    COUNT
+  };
+
+  const char* GetName(SearchSpace space) {
+    static constexpr const char* kNames[] = { "unconstrained", "port-feasible" };
+    return kNames[static_cast<size_t>(space)];
+  }
+
+  /**
+   * The genetic algorithm repairs every offspring to fit ports, which succeeds whenever ports fit all hosts.
+   * Annealing moves single hosts freely and only pays the port penalty.
+   */
+  SearchSpace GetSearchSpace(Optimizer optimizer, bool portsSuffice) {
+    return optimizer != Optimizer::SA && portsSuffice ? SearchSpace::PORT_FEASIBLE : SearchSpace::UNCONSTRAINED;
+  }
+
+  /// Best fitness at the moments it improved.
+  struct CurvePoint final {
+    double seconds;
+    double fitness;
+  };
+
+  struct Run final {
+    Optimizer optimizer;
+    uint64_t seed;
+    std::vector<CurvePoint> curve;
+    TopologyConfiguration best;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  /**
+   * Ports, traffic and bandwidth depend only on the shape, so every invocation benchmarks the same corpus.
+   */
+  TopologyInput CreateInput(const BenchmarkInstance& instance) {
+    std::mt19937_64 rng(instance.hosts * 1000 + instance.routers);
+    std::uniform_real_distribution<> dist;
+    const double offset = PortDistributor::MinRandomOffset(instance.routers, instance.hosts, 2);
+    std::vector<size_t> portsCount = PortDistributor::RandomDistribution(instance.routers, instance.hosts, offset, rng, dist);
+    return TopologyInput {
+      instance.hosts,
+      instance.routers,
+      std::move(portsCount),
+      TopologyInputGenerator::CreateTrafficMatrix(instance.hosts, { 0.5, 4500, 500 }, rng(), 1),
+      TopologyInputGenerator::CreateBandwidthMatrix(instance.routers, { 50000, 30000 }, rng())
+    };
+  }
+
+  void Record(std::vector<CurvePoint>& curve, Clock::time_point start, double fitness) {
+    if (curve.empty() || fitness > curve.back().fitness) {
+      curve.emplace_back(CurvePoint { SecondsSince(start), fitness });
+    }
+  }
+
+  Run RunGeneticAlgorithm(const TopologyInput& input, Optimizer optimizer, uint64_t seed, double budget) {
+    const size_t populationSize = 10;
+    GeneticAlgorithm::Options options { populationSize, 1.0 / populationSize, {} };
+    if (optimizer == Optimizer::GA_SEEDED) {
+      options.seeding = { 0.3, 0.05 };
+    }
+    options.adaptiveOperators = optimizer == Optimizer::GA_ADAPTIVE;
+
+    Run run { optimizer, seed, {}, {} };
+    auto start = Clock::now();
+    TopologyRandom random { std::mt19937_64(seed), {} };
+    GeneticAlgorithm algorithm(input, random, options);
+    Record(run.curve, start, algorithm.GetBest().GetFitness());
+    while (SecondsSince(start) < budget) {
+      algorithm.Step();
+      Record(run.curve, start, algorithm.GetBest().GetFitness());
+    }
+    run.best = algorithm.GetBest().GetConfiguration();
+    return run;
+  }
+
+  /**
+   * Annealing needs the steps count in advance, so it's taken from the move rate of a short probe run.
+   * The probe isn't counted in the budget.
+   */
+  Run RunSimulatedAnnealing(const TopologyInput& input, uint64_t seed, double budget) {
+    constexpr size_t kProbeSteps = 20000;
+    constexpr size_t kExchanges = 200;
+    SimulatedAnnealing::Options options;
+    options.steps = kProbeSteps;
+    options.exchangeInterval = kProbeSteps;
+    options.seed = seed;
+    auto probeStart = Clock::now();
+    SimulatedAnnealing probe(input, options);
+    probe.Step();
+    double probeSeconds = std::max(SecondsSince(probeStart), 1e-6);
+
+    options.steps = std::max(static_cast<size_t>(kProbeSteps / probeSeconds * budget), kExchanges);
+    options.exchangeInterval = options.steps / kExchanges;
+
+    Run run { Optimizer::SA, seed, {}, {} };
+    auto start = Clock::now();
+    SimulatedAnnealing annealing(input, options);
+    Record(run.curve, start, annealing.GetBestFitness());
+    while (annealing.Step()) {
+      Record(run.curve, start, annealing.GetBestFitness());
+    }
+    Record(run.curve, start, annealing.GetBestFitness());
+    run.best = annealing.CreateBestConfiguration();
+    return run;
+  }
+
+  /**
+   * Relative excess of energy (reciprocal of fitness) over the reference one.
+   */
+  double GetGap(double fitness, double referenceFitness) {
+    if (fitness >= referenceFitness) {
+      return 0.0;
+    }
+    return fitness > 0.0 ? referenceFitness / fitness - 1.0 : std::numeric_limits<double>::infinity();
+  }
+
+  /**
+   * Returns the moment the curve came within gap of the reference, negative if it never did.
+   */
+  double GetTimeToTarget(const std::vector<CurvePoint>& curve, double referenceFitness, double gap) {
+    for (const auto& point : curve) {
+      if (GetGap(point.fitness, referenceFitness) <= gap) {
+        return point.seconds;
+      }
+    }
+    return -1.0;
+  }
+
+  double GetMedian(std::vector<double> values) {
+    if (values.empty()) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    std::ranges::sort(values);
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 == 0 ? (values[middle - 1] + values[middle]) / 2.0 : values[middle];
+  }
+
+  bool ParseNumber(std::string_view text, double& value) {
+    auto [last, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && last == text.data() + text.size() && value > 0.0;
+  }
+
+  bool ParseNumber(std::string_view text, uint64_t& value) {
+    auto [last, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && last == text.data() + text.size() && value != 0;
+  }
+}
+
+// Runs every optimizer on a fixed corpus under the same wall-clock budget. Writes best-fitness-versus-time curves
+// and reports the gap to the optimum (exact on small instances, best known on the rest) and the time to reach target gaps.
+// Optima are found for both search spaces, each optimizer is compared with the optimum of the space it searches.
+int main(int argc, char** argv) {
+  double budget = 1.0;
+  uint64_t runsCount = 5;
+  std::string curvesPath = "curves.csv";
+  if ((argc > 1 && !ParseNumber(argv[1], budget)) || (argc > 2 && !ParseNumber(argv[2], runsCount))) {
+    std::cerr << "Usage: GaBenchmark [seconds per run] [runs per optimizer] [curves.csv]\n";
+    return 1;
+  }
+  if (argc > 3) {
+    curvesPath = argv[3];
+  }
+
+  std::ofstream curves(curvesPath);
+  if (!curves) {
+    std::cerr << "Can't open " << curvesPath << '\n';
+    return 1;
+  }
+  curves << "hosts,routers,optimizer,space,seed,seconds,fitness,gap\n";
+  curves << std::setprecision(std::numeric_limits<double>::max_digits10);
+  std::cout << std::setprecision(4);
+
+  for (const auto& instance : kCorpus) {
+    TopologyInput input = CreateInput(instance);
+    const bool portsSuffice = std::accumulate(input.portsCount.begin(), input.portsCount.end(), static_cast<size_t>(0)) >= input.hosts;
+    std::cout << instance.hosts << " hosts, " << instance.routers << " routers\n";
+
+    std::vector<Run> runs;
+    for (size_t i = 0; i < static_cast<size_t>(Optimizer::COUNT); ++i) {
+      auto optimizer = static_cast<Optimizer>(i);
+      for (uint64_t seed = 1; seed <= runsCount; ++seed) {
+        runs.emplace_back(optimizer == Optimizer::SA
+          ? RunSimulatedAnnealing(input, seed, budget)
+          : RunGeneticAlgorithm(input, optimizer, seed, budget));
+      }
+    }
+
+    // Reference of each space: the exact optimum when affordable, the best fitness of runs ending in the space otherwise.
+    // The best such run seeds the search
+    double referenceFitness[static_cast<size_t>(SearchSpace::COUNT)];
+    for (size_t i = 0; i < static_cast<size_t>(SearchSpace::COUNT); ++i) {
+      auto space = static_cast<SearchSpace>(i);
+      const bool portFeasible = space == SearchSpace::PORT_FEASIBLE;
+      if (portFeasible && !portsSuffice) {
+        referenceFitness[i] = std::numeric_limits<double>::quiet_NaN();
+        continue;
+      }
+
+      const Run* bestRun = nullptr;
+      for (const auto& run : runs) {
+        if ((!portFeasible || ExactSolver::IsPortFeasible(input, run.best)) && (bestRun == nullptr || run.curve.back().fitness > bestRun->curve.back().fitness)) {
+          bestRun = &run;
+        }
+      }
+      referenceFitness[i] = bestRun != nullptr ? bestRun->curve.back().fitness : 0.0;
+
+      std::cout << "  " << GetName(space);
+      if (instance.exact) {
+        auto start = Clock::now();
+        ExactSolver::Options options;
+        options.portFeasible = portFeasible;
+        ExactSolver::Result result = ExactSolver::Solve(input, bestRun != nullptr ? bestRun->best : runs.front().best, options);
+        std::cout << " exact fitness " << result.fitness << (result.optimal ? " (optimal" : " (not proven optimal")
+          << ", " << result.nodes << " nodes, " << SecondsSince(start) << " s)\n";
+        referenceFitness[i] = std::max(referenceFitness[i], result.fitness);
+      }
+      else {
+        std::cout << " best known fitness " << referenceFitness[i] << '\n';
+      }
+    }
+
+    for (const auto& run : runs) {
+      SearchSpace space = GetSearchSpace(run.optimizer, portsSuffice);
+      for (const auto& point : run.curve) {
+        curves << instance.hosts << ',' << instance.routers << ',' << GetName(run.optimizer) << ',' << GetName(space) << ',' << run.seed << ','
+          << point.seconds << ',' << point.fitness << ',' << GetGap(point.fitness, referenceFitness[static_cast<size_t>(space)]) << '\n';
+      }
+    }
+
+    for (size_t i = 0; i < static_cast<size_t>(Optimizer::COUNT); ++i) {
+      auto optimizer = static_cast<Optimizer>(i);
+      SearchSpace space = GetSearchSpace(optimizer, portsSuffice);
+      const double reference = referenceFitness[static_cast<size_t>(space)];
+      std::vector<double> gaps;
+      std::vector<std::vector<double>> times(std::size(kTargetGaps));
+      for (const auto& run : runs) {
+        if (run.optimizer != optimizer) {
+          continue;
+        }
+        gaps.emplace_back(GetGap(run.curve.back().fitness, reference));
+        for (size_t target = 0; target < std::size(kTargetGaps); ++target) {
+          double time = GetTimeToTarget(run.curve, reference, kTargetGaps[target]);
+          if (time >= 0.0) {
+            times[target].emplace_back(time);
+          }
+        }
+      }
+
+      std::cout << "  " << std::left << std::setw(14) << GetName(optimizer) << std::setw(16) << GetName(space) << std::right
+        << "gap median " << GetMedian(gaps) * 100.0 << "%, worst " << *std::ranges::max_element(gaps) * 100.0 << '%';
+      for (size_t target = 0; target < std::size(kTargetGaps); ++target) {
+        std::cout << "; " << kTargetGaps[target] * 100.0 << "% reached " << times[target].size() << '/' << runsCount;
+        if (!times[target].empty()) {
+          std::cout << " in " << GetMedian(times[target]) << " s";
+        }
+      }
+      std::cout << '\n';
+    }
+  }
+
+  std::cout << "Curves written to " << curvesPath << '\n';
+  return 0;
+}
@@ -0,0 +1,23 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+// Replacement of global allocation functions. Array and nothrow forms forward here by default.
+
+void* operator new(std::size_t size) {
+  AllocationCounter::OnAllocation();
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Counts heap allocations made through global operator new.
+ * Counting works only when AllocationCounter.cpp is linked into the executable, otherwise the counter stays at zero.
+ */
+struct AllocationCounter final {
+  static size_t GetAllocations() {
+    return s_allocations.load(std::memory_order_relaxed);
+  }
+
+  static void OnAllocation() {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+private:
+  inline static std::atomic<size_t> s_allocations { 0 };
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "EpochEvaluator.h"
+#include "EvaluationBatch.h"
+#include "FixedRouterKernels.h"
+#include "Parallel.h"
+#include "ParallelEvaluator.h"
+#include "ParetoSorting.h"
+#include "TopologyInput.h"
+
+#include <algorithm>
+#include <cassert>
+#include <span>
+#include <vector>
+
+/**
+ * Evaluates a whole generation at once.
+ * Instead of walking subnetworks of each configuration, sums host traffic into a router-level flow matrix:
+ *   flow(r1, r2) = sum of traffic(h1, h2) where h1 is in subnetwork r1 and h2 is in subnetwork r2.
+ * Channel load is then derived in O(routers^2): a switch sends flow(r1, r2) to r2, a hub sends all flow of r1 to every router.
+ * Each traffic matrix column is streamed once per batch and reused by all configurations while it's still in cache.
+ * Small router counts are dispatched to FixedRouterKernels, the loops below are the generic fallback.
+ * Flows of large host counts are accumulated by ParallelEvaluator.
+ */
+struct BatchEvaluator final {
+  static void Evaluate(const TopologyInput& input, EvaluationBatch& batch) {
+    assert(batch.hosts == input.hosts && batch.routers == input.routers);
+    const auto* kernel = FixedRouterKernels::Find(input.routers);
+    if (input.hosts >= ParallelEvaluator::kMinHosts) {
+      ParallelEvaluator::AccumulateFlows(input, batch, Parallel::GetThreadsCount());
+    }
+    else if (kernel) {
+      kernel->accumulateFlows(input, batch);
+    }
+    else {
+      AccumulateFlows(input, batch);
+    }
+
+    for (size_t i = 0; i < batch.count; ++i) {
+      if (kernel) {
+        kernel->evaluateFlows(input, batch, i);
+      }
+      else {
+        EvaluateFlows(input, batch, i);
+      }
+    }
+
+    // Loads stay those of the mean traffic, objectives come from all epochs
+    if (input.epochs.IsPerEpoch()) {
+      EpochEvaluator::Evaluate(input, batch);
+    }
+  }
+
+private:
+  static void AccumulateFlows(const TopologyInput& input, EvaluationBatch& batch) {
+    const size_t hosts = input.hosts;
+    const size_t routers = input.routers;
+    const size_t* traffic = input.trafficMatrix.GetData().data();
+
+    std::ranges::fill(batch.flows, 0);
+
+    // traffic(h, col) is contiguous in h
+    for (size_t col = 0; col < hosts; ++col) {
+      const size_t* column = traffic + hosts * col;
+
+      for (size_t i = 0; i < batch.count; ++i) {
+        const size_t* membership = batch.membership.data() + i * hosts;
+        size_t* flowColumn = batch.flows.data() + i * routers * routers + routers * membership[col];
+
+        for (size_t host = 0; host < hosts; ++host) {
+          flowColumn[membership[host]] += column[host];
+        }
+      }
+    }
+  }
+
+  /**
+   * Derives loads, traffic difference, port penalty, total traffic and distance of configuration from its flow matrix.
+   */
+  static void EvaluateFlows(const TopologyInput& input, EvaluationBatch& batch, size_t index) {
+    const size_t routers = input.routers;
+    const size_t* flows = batch.flows.data() + index * routers * routers;
+    const RouterType* routerTypes = batch.routerTypes.data() + index * routers;
+    size_t* loads = batch.loads.data() + index * routers * routers;
+
+    size_t* flowSums = batch.flowSums.data() + index * routers;
+    std::fill(flowSums, flowSums + routers, 0);
+    for (size_t to = 0; to < routers; ++to) {
+      for (size_t from = 0; from < routers; ++from) {
+        flowSums[from] += flows[from + routers * to];
+      }
+    }
+
+    // Output of a router towards another one. flow(r1, r2) is stored at r1 + routers * r2
+    auto output = [&](size_t from, size_t to) {
+      return routerTypes[from] == RouterType::SWITCH ? flows[from + routers * to] : flowSums[from];
+    };
+
+    size_t trafficDifference = 0;
+    size_t traffic = 0;
+    for (size_t row = 0; row < routers; ++row) {
+      loads[row + routers * row] = 0;
+      for (size_t col = row + 1; col < routers; ++col) {
+        size_t load = output(row, col) + output(col, row);
+        loads[row + routers * col] = load;
+        loads[col + routers * row] = load;
+
+        size_t twoSided = load + load;
+        size_t bandwidth = input.bandwidthMatrix.At(row, col);
+        trafficDifference += std::max(twoSided, bandwidth) - std::min(twoSided, bandwidth);
+        traffic += twoSided;
+      }
+    }
+
+    const size_t* membership = batch.membership.data() + index * input.hosts;
+    size_t* hostsCount = batch.hostsCount.data() + index * routers;
+    std::fill(hostsCount, hostsCount + routers, 0);
+    for (size_t host = 0; host < input.hosts; ++host) {
+      ++hostsCount[membership[host]];
+    }
+
+    size_t portPenalty = 0;
+    for (size_t router = 0; router < routers; ++router) {
+      if (hostsCount[router] > input.portsCount[router]) {
+        portPenalty += hostsCount[router] - input.portsCount[router];
+      }
+    }
+
+    batch.objectives[index] = Objectives { { trafficDifference, portPenalty, traffic }, input.CalculateDistance({ membership, input.hosts }) };
+  }
+};
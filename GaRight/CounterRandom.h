@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counter-based random number generator (Philox4x32-10).
+ * Output is a pure function of (seed, stream, counter), so every element of a generated instance
+ * can be produced independently of others, in any order and on any thread.
+ */
+struct CounterRandom final {
+  using Block = std::array<uint32_t, 4>;
+
+  explicit CounterRandom(uint64_t seed, uint32_t stream = 0)
+    : m_key { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) ^ stream } {
+  }
+
+  /**
+   * Returns 128 random bits for the counter.
+   */
+  Block Generate(Block counter) const {
+    uint32_t key0 = m_key[0];
+    uint32_t key1 = m_key[1];
+
+    for (size_t round = 0; round < kRounds; ++round) {
+      uint64_t product0 = static_cast<uint64_t>(kMultiplier0) * counter[0];
+      uint64_t product1 = static_cast<uint64_t>(kMultiplier1) * counter[2];
+      counter = {
+        static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key0,
+        static_cast<uint32_t>(product1),
+        static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key1,
+        static_cast<uint32_t>(product0)
+      };
+      key0 += kWeyl0;
+      key1 += kWeyl1;
+    }
+
+    return counter;
+  }
+
+  /**
+   * Returns two random 64-bit words keyed on (row, col).
+   */
+  std::array<uint64_t, 2> At(uint64_t row, uint64_t col) const {
+    Block block = Generate({
+      static_cast<uint32_t>(row),
+      static_cast<uint32_t>(row >> 32),
+      static_cast<uint32_t>(col),
+      static_cast<uint32_t>(col >> 32)
+    });
+
+    return {
+      static_cast<uint64_t>(block[1]) << 32 | block[0],
+      static_cast<uint64_t>(block[3]) << 32 | block[2]
+    };
+  }
+
+  /**
+   * Maps random bits to [0, 1) with 53-bit resolution.
+   */
+  static double ToUnit(uint64_t bits) {
+    return static_cast<double>(bits >> 11) * 0x1.0p-53;
+  }
+
+private:
+  static constexpr size_t kRounds = 10;
+  static constexpr uint32_t kMultiplier0 = 0xD2511F53;
+  static constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+  static constexpr uint32_t kWeyl0 = 0x9E3779B9;
+  static constexpr uint32_t kWeyl1 = 0xBB67AE85;
+
+  std::array<uint32_t, 2> m_key;
+};
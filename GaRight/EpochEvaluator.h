@@ -0,0 +1,124 @@
+#pragma once
+
+#include "EvaluationBatch.h"
+#include "ParetoSorting.h"
+#include "TopologyGenerator.h"
+#include "TopologyInput.h"
+
+#include <algorithm>
+#include <cassert>
+#include <span>
+#include <vector>
+
+/**
+ * Evaluates traffic difference and traffic of every epoch and combines them by TrafficEpochs::Aggregate.
+ * Flows of all epochs are accumulated in one traversal of the interleaved traffic, the innermost loop runs over epochs.
+ * Mean traffic is linear, so with mean aggregation traffic is kept as evaluated from the mean traffic matrix.
+ */
+struct EpochEvaluator final {
+  /**
+   * Replaces traffic difference and traffic of batch objectives by their aggregation over epochs. Objectives of the mean traffic matrix must be already evaluated.
+   */
+  static void Evaluate(const TopologyInput& input, EvaluationBatch& batch) {
+    assert(batch.epochs == input.epochs.count);
+    const size_t hosts = input.hosts;
+    const size_t routers = input.routers;
+    const size_t epochs = input.epochs.count;
+    const size_t* traffic = input.epochs.traffic.data();
+
+    std::ranges::fill(batch.epochFlows, 0);
+    for (size_t col = 0; col < hosts; ++col) {
+      const size_t* column = traffic + hosts * epochs * col;
+
+      for (size_t i = 0; i < batch.count; ++i) {
+        const size_t* membership = batch.membership.data() + i * hosts;
+        size_t* flowColumn = batch.epochFlows.data() + (i * routers * routers + routers * membership[col]) * epochs;
+        AccumulateColumn(column, membership, hosts, epochs, flowColumn);
+      }
+    }
+
+    for (size_t i = 0; i < batch.count; ++i) {
+      Combine(
+        input,
+        batch.epochFlows.data() + i * routers * routers * epochs,
+        batch.routerTypes.data() + i * routers,
+        batch.epochFlowSums.data() + i * routers * epochs,
+        batch.epochValues.data() + i * 2 * epochs,
+        batch.objectives[i]);
+    }
+  }
+
+  /**
+   * Same as above for a single configuration.
+   */
+  static void Evaluate(const TopologyInput& input, std::span<const size_t> membershipTable, std::span<const RouterType> routerTypeTable, Objectives& objectives) {
+    const size_t hosts = input.hosts;
+    const size_t routers = input.routers;
+    const size_t epochs = input.epochs.count;
+    const size_t* traffic = input.epochs.traffic.data();
+
+    std::vector<size_t> flows(routers * routers * epochs, 0);
+    for (size_t col = 0; col < hosts; ++col) {
+      AccumulateColumn(traffic + hosts * epochs * col, membershipTable.data(), hosts, epochs, flows.data() + routers * membershipTable[col] * epochs);
+    }
+
+    std::vector<size_t> flowSums(routers * epochs);
+    std::vector<size_t> values(2 * epochs);
+    Combine(input, flows.data(), routerTypeTable.data(), flowSums.data(), values.data(), objectives);
+  }
+
+private:
+  /**
+   * flow(membership[host], col's router, epoch) += traffic(host, col, epoch) for every host and epoch.
+   */
+  static void AccumulateColumn(const size_t* column, const size_t* membership, size_t hosts, size_t epochs, size_t* flowColumn) {
+    for (size_t host = 0; host < hosts; ++host) {
+      size_t* flow = flowColumn + membership[host] * epochs;
+      const size_t* source = column + host * epochs;
+      for (size_t epoch = 0; epoch < epochs; ++epoch) {
+        flow[epoch] += source[epoch];
+      }
+    }
+  }
+
+  /**
+   * Derives per-epoch loads from flows, flow(r1, r2, epoch) is stored at (r1 + routers * r2) * epochs + epoch.
+   */
+  static void Combine(const TopologyInput& input, const size_t* flows, const RouterType* routerTypes, size_t* flowSums, size_t* values, Objectives& objectives) {
+    const size_t routers = input.routers;
+    const size_t epochs = input.epochs.count;
+
+    std::fill(flowSums, flowSums + routers * epochs, 0);
+    for (size_t to = 0; to < routers; ++to) {
+      for (size_t from = 0; from < routers; ++from) {
+        const size_t* flow = flows + (from + routers * to) * epochs;
+        for (size_t epoch = 0; epoch < epochs; ++epoch) {
+          flowSums[from * epochs + epoch] += flow[epoch];
+        }
+      }
+    }
+
+    size_t* differences = values;
+    size_t* traffics = values + epochs;
+    std::fill(values, values + 2 * epochs, 0);
+    for (size_t row = 0; row < routers; ++row) {
+      for (size_t col = row + 1; col < routers; ++col) {
+        // Switch sends flow(r1, r2) to r2, hub sends all flow of r1
+        const size_t* forward = routerTypes[row] == RouterType::SWITCH ? flows + (row + routers * col) * epochs : flowSums + row * epochs;
+        const size_t* backward = routerTypes[col] == RouterType::SWITCH ? flows + (col + routers * row) * epochs : flowSums + col * epochs;
+        size_t bandwidth = input.bandwidthMatrix.At(row, col);
+
+        for (size_t epoch = 0; epoch < epochs; ++epoch) {
+          size_t twoSided = (forward[epoch] + backward[epoch]) * 2;
+          differences[epoch] += std::max(twoSided, bandwidth) - std::min(twoSided, bandwidth);
+          traffics[epoch] += twoSided;
+        }
+      }
+    }
+
+    objectives.values[0] = input.epochs.Aggregate({ differences, epochs });
+    if (input.epochs.IsTrafficPerEpoch()) {
+      objectives.values[2] = input.epochs.Aggregate({ traffics, epochs });
+    }
+  }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ParetoSorting.h"
+#include "TopologyGenerator.h"
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+/**
+ * Configurations of a whole generation laid out as structure of arrays.
+ */
+struct EvaluationBatch final {
+  /// Number of configurations.
+  size_t count = 0;
+  size_t hosts = 0;
+  size_t routers = 0;
+  /// Traffic epochs evaluated separately. Zero if only the mean traffic is evaluated.
+  size_t epochs = 0;
+  /// [individual x host] default gateway of each host.
+  std::vector<size_t> membership;
+  /// [individual x router] router types.
+  std::vector<RouterType> routerTypes;
+  /// [individual x router^2] one-sided traffic between subnetworks. Scratch of the evaluation.
+  std::vector<size_t> flows;
+  /// [individual x router] total flow out of each router. Scratch of the evaluation.
+  std::vector<size_t> flowSums;
+  /// [individual x router] hosts count of each router. Scratch of the evaluation.
+  std::vector<size_t> hostsCount;
+  /// [individual x router^2 x epoch] flows of each traffic epoch. Scratch of the evaluation.
+  std::vector<size_t> epochFlows;
+  /// [individual x router x epoch] total flow out of each router per epoch. Scratch of the evaluation.
+  std::vector<size_t> epochFlowSums;
+  /// [individual x 2 x epoch] traffic difference and traffic of each epoch. Scratch of the evaluation.
+  std::vector<size_t> epochValues;
+  /// [thread x individual x router^2] per-thread flows of the parallel evaluation. Scratch, sized by ParallelEvaluator.
+  std::vector<size_t> partialFlows;
+  /// [individual x (thread + 1)] router slices of the parallel evaluation. Scratch, sized by ParallelEvaluator.
+  std::vector<size_t> routerSlices;
+  /// [individual x router^2] two-sided channel load. Same layout as SymmetricalMatrix data.
+  std::vector<size_t> loads;
+  /// [individual] evaluation results.
+  std::vector<Objectives> objectives;
+
+  /**
+   * Sizes all blocks. Keeps capacity, so resizing to the same shape doesn't allocate.
+   */
+  void Resize(size_t newCount, size_t newHosts, size_t newRouters, size_t newEpochs = 0) {
+    count = newCount;
+    hosts = newHosts;
+    routers = newRouters;
+    epochs = newEpochs;
+    membership.resize(count * hosts);
+    routerTypes.resize(count * routers);
+    flows.resize(count * routers * routers);
+    flowSums.resize(count * routers);
+    hostsCount.resize(count * routers);
+    epochFlows.resize(count * routers * routers * epochs);
+    epochFlowSums.resize(count * routers * epochs);
+    epochValues.resize(count * 2 * epochs);
+    loads.resize(count * routers * routers);
+    objectives.resize(count);
+  }
+
+  /**
+   * Copies chromosome tables into slot index.
+   */
+  void Store(size_t index, std::span<const size_t> membershipTable, std::span<const RouterType> routerTypeTable) {
+    std::ranges::copy(membershipTable, membership.begin() + index * hosts);
+    std::ranges::copy(routerTypeTable, routerTypes.begin() + index * routers);
+  }
+
+  std::span<const size_t> GetLoads(size_t index) const {
+    return { loads.data() + index * routers * routers, routers * routers };
+  }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Individual.h"
+#include "ReferenceEvaluator.h"
+#include "TopologyInput.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+/**
+ * Re-evaluates a sample of individuals with ReferenceEvaluator and aborts with a diff on any mismatch.
+ * Sampling uses its own generator, so verification doesn't change the course of the run.
+ */
+struct EvaluationVerifier final {
+  explicit EvaluationVerifier(double sampleRate, uint64_t seed = 0)
+    : m_sampleRate(sampleRate)
+    , m_rng(seed)
+    , m_dist(0.0, 1.0)
+    , m_verified(0) {
+  }
+
+  bool IsEnabled() const {
+    return m_sampleRate > 0.0;
+  }
+
+  /**
+   * Verifies the individual with probability of the sample rate.
+   */
+  void Sample(const TopologyInput& input, const Individual& individual) {
+    if (m_sampleRate > 0.0 && m_dist(m_rng) < m_sampleRate) {
+      Verify(input, individual);
+    }
+  }
+
+  void Verify(const TopologyInput& input, const Individual& individual) {
+    std::string diff = Compare(input, individual.GetConfiguration(), individual.GetObjectives(), individual.GetFitness());
+    ++m_verified;
+    if (!diff.empty()) {
+      std::cerr << "Evaluation mismatch after " << m_verified << " verified individuals:\n" << diff << std::flush;
+      std::abort();
+    }
+  }
+
+  size_t GetVerifiedCount() const {
+    return m_verified;
+  }
+
+  /**
+   * Returns a description of differences between the stored evaluation and the reference one, empty if they match.
+   */
+  static std::string Compare(const TopologyInput& input, const TopologyConfiguration& conf, const Objectives& objectives, double fitness) {
+    static constexpr const char* kObjectiveNames[Objectives::kCount] = { "traffic difference", "port penalty", "traffic" };
+    auto reference = ReferenceEvaluator::Evaluate(input, conf.membershipTable, conf.routerTypeTable);
+    std::ostringstream os;
+
+    const auto& loads = conf.channelLoadMatrix;
+    if (loads.GetWidth() != reference.loadMatrix.GetWidth() || loads.GetHeight() != reference.loadMatrix.GetHeight()) {
+      os << "  load matrix size: " << loads.GetWidth() << 'x' << loads.GetHeight()
+        << ", expected " << reference.loadMatrix.GetWidth() << 'x' << reference.loadMatrix.GetHeight() << '\n';
+    }
+    else {
+      for (size_t row = 0; row < input.routers; ++row) {
+        for (size_t col = 0; col < input.routers; ++col) {
+          if (loads.At(row, col) != reference.loadMatrix.At(row, col)) {
+            os << "  load(" << row << ", " << col << "): " << loads.At(row, col) << ", expected " << reference.loadMatrix.At(row, col) << '\n';
+          }
+        }
+      }
+    }
+
+    for (size_t i = 0; i < Objectives::kCount; ++i) {
+      if (objectives.values[i] != reference.objectives.values[i]) {
+        os << "  " << kObjectiveNames[i] << ": " << objectives.values[i] << ", expected " << reference.objectives.values[i] << '\n';
+      }
+    }
+    if (objectives.distance != reference.objectives.distance) {
+      os << "  distance: " << objectives.distance << ", expected " << reference.objectives.distance << '\n';
+    }
+
+    if (fitness != reference.fitness) {
+      os << "  fitness: " << fitness << ", expected " << reference.fitness << '\n';
+    }
+
+    if (os.tellp() == 0) {
+      return {};
+    }
+    os << "Configuration:\n" << conf;
+    return os.str();
+  }
+
+private:
+  double m_sampleRate;
+  std::mt19937_64 m_rng;
+  std::uniform_real_distribution<double> m_dist;
+  size_t m_verified;
+};
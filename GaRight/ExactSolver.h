@@ -0,0 +1,292 @@
+#pragma once
+
+#include "Individual.h"
+#include "Topology.h"
+#include "TopologyGenerator.h"
+#include "TopologyInput.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+/**
+ * Branch and bound over router type and membership tables for instances small enough to solve exactly.
+ * Router types are enumerated, hosts are assigned one by one, heaviest first. Traffic is non-negative, so flows between
+ * routers of the assigned hosts only grow as more hosts are assigned, and grow by at most the traffic that involves unassigned hosts.
+ * This brackets every channel load and bounds the traffic difference, the port penalty only grows too.
+ * The genetic algorithm repairs offspring to fit ports, so its optimum is the port-feasible one, see Options::portFeasible.
+ */
+struct ExactSolver final {
+  struct Options final {
+    /// Search nodes before giving up. The result is then the best found, not proven optimal.
+    size_t maxNodes = 100000000;
+    /// Searches only configurations without over-subscribed routers. Requires ports of all routers to fit all hosts.
+    bool portFeasible = false;
+  };
+
+  struct Result final {
+    std::vector<size_t> membershipTable;
+    std::vector<RouterType> routerTypeTable;
+    double fitness;
+    /// False if the search stopped at the nodes limit.
+    bool optimal;
+    size_t nodes;
+  };
+
+  /**
+   * Finds the configuration of maximal fitness. Initial configuration gives the first incumbent, the better it is the more is pruned.
+   * Traffic epochs aren't supported. Over-subscribed initial configuration doesn't bound the port-feasible search,
+   * it's returned with zero fitness only if candidates of hosts leave no port-feasible configuration.
+   */
+  static Result Solve(const TopologyInput& input, const TopologyConfiguration& initial, const Options& options) {
+    assert(!input.epochs.IsPerEpoch() && input.routers != 0);
+    assert(!options.portFeasible || std::accumulate(input.portsCount.begin(), input.portsCount.end(), static_cast<size_t>(0)) >= input.hosts);
+    Search search(input, options);
+    search.bestMembership = initial.membershipTable;
+    search.bestTypes = initial.routerTypeTable;
+    if (!options.portFeasible || IsPortFeasible(input, initial)) {
+      search.bestEnergy = 1.0 / Individual::CalculateFitness(input, initial);
+    }
+
+    constexpr size_t types = static_cast<size_t>(RouterType::COUNT);
+    size_t combinations = 1;
+    for (size_t i = 0; i < input.routers; ++i) {
+      combinations *= types;
+    }
+    for (size_t combination = 0; combination < combinations && !search.IsStopped(); ++combination) {
+      for (size_t i = 0, rest = combination; i < input.routers; ++i, rest /= types) {
+        search.types[i] = static_cast<RouterType>(rest % types);
+      }
+      search.Branch(0);
+    }
+
+    return Result {
+      std::move(search.bestMembership),
+      std::move(search.bestTypes),
+      1.0 / search.bestEnergy,
+      !search.IsStopped(),
+      search.nodes
+    };
+  }
+
+  static bool IsPortFeasible(const TopologyInput& input, const TopologyConfiguration& conf) {
+    std::vector<size_t> hostsCount(input.routers, 0);
+    for (size_t router : conf.membershipTable) {
+      if (++hostsCount[router] > input.portsCount[router]) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+private:
+  struct Search final {
+    static constexpr size_t kUnassigned = std::numeric_limits<size_t>::max();
+
+    const TopologyInput& input;
+    const Options& options;
+    /// Hosts in assignment order, by descending traffic.
+    std::vector<size_t> order;
+    /// Routers each host may use.
+    std::vector<std::vector<size_t>> domains;
+    /// Distance to the nearest router of each host's domain.
+    std::vector<double> nearest;
+    size_t totalTraffic;
+
+    std::vector<size_t> membership;
+    std::vector<RouterType> types;
+    std::vector<size_t> hostsCount;
+    /// [from + routers * to] traffic between assigned hosts.
+    std::vector<size_t> flows;
+    std::vector<size_t> flowSums;
+    size_t assignedTraffic;
+    double distance;
+    size_t nodes;
+
+    std::vector<size_t> bestMembership;
+    std::vector<RouterType> bestTypes;
+    double bestEnergy;
+
+    explicit Search(const TopologyInput& input, const Options& options)
+      : input(input)
+      , options(options)
+      , totalTraffic(0)
+      , membership(input.hosts, kUnassigned)
+      , types(input.routers, RouterType::SWITCH)
+      , hostsCount(input.routers, 0)
+      , flows(input.routers * input.routers, 0)
+      , flowSums(input.routers, 0)
+      , assignedTraffic(0)
+      , distance(0.0)
+      , nodes(0)
+      , bestEnergy(std::numeric_limits<double>::infinity()) {
+      std::vector<size_t> hostTraffic(input.hosts, 0);
+      for (size_t col = 0; col < input.hosts; ++col) {
+        for (size_t row = 0; row < input.hosts; ++row) {
+          size_t traffic = input.trafficMatrix.At(row, col);
+          hostTraffic[row] += traffic;
+          hostTraffic[col] += traffic;
+          totalTraffic += traffic;
+        }
+      }
+
+      order.resize(input.hosts);
+      for (size_t i = 0; i < input.hosts; ++i) {
+        order[i] = i;
+      }
+      std::ranges::stable_sort(order, [&](size_t lhs, size_t rhs) {
+        return hostTraffic[lhs] > hostTraffic[rhs];
+      });
+
+      domains.resize(input.hosts);
+      nearest.assign(input.hosts, 0.0);
+      for (size_t host = 0; host < input.hosts; ++host) {
+        if (input.candidates.IsEmpty()) {
+          for (size_t router = 0; router < input.routers; ++router) {
+            domains[host].emplace_back(router);
+          }
+        }
+        else {
+          auto candidates = input.candidates.Get(host);
+          domains[host].assign(candidates.begin(), candidates.end());
+        }
+
+        if (input.HasLayout()) {
+          nearest[host] = std::numeric_limits<double>::infinity();
+          for (size_t router : domains[host]) {
+            nearest[host] = std::min(nearest[host], input.GetDistance(host, router));
+          }
+        }
+      }
+    }
+
+    bool IsStopped() const {
+      return nodes >= options.maxNodes;
+    }
+
+    /**
+     * Adds traffic between host and assigned hosts to flows of router, or removes it.
+     */
+    void Assign(size_t host, size_t router, bool add) {
+      const size_t routers = input.routers;
+      auto update = [add](size_t& target, size_t value) {
+        target = add ? target + value : target - value;
+      };
+
+      if (!add) {
+        membership[host] = kUnassigned;
+      }
+      size_t self = input.trafficMatrix.At(host, host);
+      size_t changed = self;
+      update(flows[router + routers * router], self);
+      update(flowSums[router], self);
+      for (size_t peer = 0; peer < input.hosts; ++peer) {
+        size_t peerRouter = membership[peer];
+        if (peerRouter == kUnassigned || peer == host) {
+          continue;
+        }
+        size_t out = input.trafficMatrix.At(host, peer);
+        size_t in = input.trafficMatrix.At(peer, host);
+        update(flows[router + routers * peerRouter], out);
+        update(flows[peerRouter + routers * router], in);
+        update(flowSums[router], out);
+        update(flowSums[peerRouter], in);
+        changed += out + in;
+      }
+      update(assignedTraffic, changed);
+      update(hostsCount[router], 1);
+      if (input.HasLayout()) {
+        distance += add ? input.GetDistance(host, router) : -input.GetDistance(host, router);
+      }
+      if (add) {
+        membership[host] = router;
+      }
+    }
+
+    /**
+     * Lower bound of the energy (reciprocal of fitness) of any completion of the assignment, exact once all hosts are assigned.
+     */
+    double Bound(size_t assigned) const {
+      const size_t routers = input.routers;
+      const size_t unassignedTraffic = totalTraffic - assignedTraffic;
+      auto output = [&](size_t from, size_t to) {
+        return types[from] == RouterType::SWITCH ? flows[from + routers * to] : flowSums[from];
+      };
+
+      // Load of a channel can only grow, by at most the unassigned traffic from each side
+      size_t difference = 0;
+      for (size_t row = 0; row < routers; ++row) {
+        for (size_t col = row + 1; col < routers; ++col) {
+          size_t low = 2 * (output(row, col) + output(col, row));
+          size_t high = low + 4 * unassignedTraffic;
+          size_t bandwidth = input.bandwidthMatrix.At(row, col);
+          difference += low > bandwidth ? low - bandwidth : high < bandwidth ? bandwidth - high : 0;
+        }
+      }
+
+      // Unassigned hosts fill free ports first
+      size_t penalty = 0;
+      size_t freePorts = 0;
+      for (size_t router = 0; router < routers; ++router) {
+        size_t ports = input.portsCount[router];
+        penalty += hostsCount[router] > ports ? hostsCount[router] - ports : 0;
+        freePorts += hostsCount[router] < ports ? ports - hostsCount[router] : 0;
+      }
+      size_t unassigned = input.hosts - assigned;
+      penalty += unassigned > freePorts ? unassigned - freePorts : 0;
+
+      double minDistance = distance;
+      for (size_t i = assigned; i < input.hosts; ++i) {
+        minDistance += nearest[order[i]];
+      }
+
+      double cost = difference + input.distanceWeight * minDistance;
+      return cost + cost * penalty;
+    }
+
+    void Branch(size_t assigned) {
+      if (IsStopped()) {
+        return;
+      }
+      ++nodes;
+
+      double bound = Bound(assigned);
+      if (bound >= bestEnergy) {
+        return;
+      }
+      if (assigned == input.hosts) {
+        bestEnergy = bound;
+        bestMembership = membership;
+        bestTypes = types;
+        return;
+      }
+
+      // Most promising router first
+      const size_t host = order[assigned];
+      std::vector<std::pair<double, size_t>> children;
+      children.reserve(domains[host].size());
+      for (size_t router : domains[host]) {
+        // Full router. With enough ports in total the bound's penalty then stays zero
+        if (options.portFeasible && hostsCount[router] >= input.portsCount[router]) {
+          continue;
+        }
+        Assign(host, router, true);
+        children.emplace_back(Bound(assigned + 1), router);
+        Assign(host, router, false);
+      }
+      std::ranges::sort(children);
+
+      for (const auto& [childBound, router] : children) {
+        if (childBound >= bestEnergy) {
+          break;
+        }
+        Assign(host, router, true);
+        Branch(assigned + 1);
+        Assign(host, router, false);
+      }
+    }
+  };
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "EvaluationBatch.h"
+#include "Matrix.h"
+#include "ParetoSorting.h"
+#include "TopologyGenerator.h"
+#include "TopologyInput.h"
+
+#include <array>
+#include <span>
+#include <utility>
+
+/**
+ * Calls function(std::integral_constant<size_t, I>()) for every I of the sequence. Fully unrolled.
+ */
+template <size_t... I, typename Function>
+inline void Unroll(std::index_sequence<I...>, Function&& function) {
+  (function(std::integral_constant<size_t, I>()), ...);
+}
+
+/**
+ * Evaluation kernels specialised on a compile-time router count.
+ * Router tables, ports and the flow and load matrices live in std::array, router-pair loops are unrolled,
+ * so evaluation time is dominated by the host traffic scan.
+ */
+template <size_t R>
+struct FixedRouterKernel final {
+  using Flows = std::array<size_t, R * R>;
+
+  /**
+   * Sums traffic into flows of all batch configurations. flow(r1, r2) is stored at r1 + R * r2.
+   */
+  static void AccumulateFlows(const TopologyInput& input, EvaluationBatch& batch) {
+    const size_t hosts = input.hosts;
+    const size_t* traffic = input.trafficMatrix.GetData().data();
+    std::ranges::fill(batch.flows, 0);
+
+    for (size_t col = 0; col < hosts; ++col) {
+      const size_t* column = traffic + hosts * col;
+
+      for (size_t i = 0; i < batch.count; ++i) {
+        const size_t* membership = batch.membership.data() + i * hosts;
+        size_t* flowColumn = batch.flows.data() + i * R * R + R * membership[col];
+
+        for (size_t host = 0; host < hosts; ++host) {
+          flowColumn[membership[host]] += column[host];
+        }
+      }
+    }
+  }
+
+  /**
+   * Derives loads and objectives of batch configuration from its flows.
+   */
+  static void EvaluateFlows(const TopologyInput& input, EvaluationBatch& batch, size_t index) {
+    Flows flows;
+    std::copy_n(batch.flows.data() + index * R * R, R * R, flows.begin());
+    const size_t* membership = batch.membership.data() + index * input.hosts;
+
+    Flows loads;
+    Objectives objectives = Evaluate(input, flows, { batch.routerTypes.data() + index * R, R }, { membership, input.hosts }, loads);
+    std::ranges::copy(loads, batch.loads.begin() + index * R * R);
+    batch.objectives[index] = objectives;
+  }
+
+  /**
+   * Fills load matrix of a single configuration. Flow matrix stays on the stack.
+   */
+  static void FillLoadMatrix(const TopologyInput& input, std::span<const size_t> membership, std::span<const RouterType> routerTypes, SymmetricalMatrix<size_t>& loadMatrix) {
+    const size_t hosts = input.hosts;
+    const size_t* traffic = input.trafficMatrix.GetData().data();
+    Flows flows {};
+
+    for (size_t col = 0; col < hosts; ++col) {
+      const size_t* column = traffic + hosts * col;
+      size_t* flowColumn = flows.data() + R * membership[col];
+
+      for (size_t host = 0; host < hosts; ++host) {
+        flowColumn[membership[host]] += column[host];
+      }
+    }
+
+    Flows loads;
+    CreateLoads(flows, routerTypes, loads);
+    if (loadMatrix.GetWidth() != R) {
+      loadMatrix = SymmetricalMatrix<size_t>(R);
+    }
+    loadMatrix.Assign(loads);
+  }
+
+  /**
+   * Calculates sum|Ti-Bi| over router pairs of a load matrix.
+   */
+  static size_t CalculateTrafficDifference(const TopologyInput& input, const SymmetricalMatrix<size_t>& loadMatrix) {
+    Flows loads;
+    std::ranges::copy(loadMatrix.GetData(), loads.begin());
+    return CalculateTrafficDifference(input, loads);
+  }
+
+private:
+  using Sequence = std::make_index_sequence<R>;
+  template <size_t I>
+  using Index = std::integral_constant<size_t, I>;
+
+  static void CreateLoads(const Flows& flows, std::span<const RouterType> routerTypes, Flows& loads) {
+    std::array<size_t, R> flowSums {};
+    std::array<bool, R> switches;
+    Unroll(Sequence(), [&]<size_t from>(Index<from>) {
+      switches[from] = routerTypes[from] == RouterType::SWITCH;
+      Unroll(Sequence(), [&]<size_t to>(Index<to>) {
+        flowSums[from] += flows[from + R * to];
+      });
+    });
+
+    Unroll(Sequence(), [&]<size_t row>(Index<row>) {
+      Unroll(Sequence(), [&]<size_t col>(Index<col>) {
+        if constexpr (col == row) {
+          loads[row + R * col] = 0;
+        }
+        else {
+          // Switch sends flow(r1, r2) to r2, hub sends all flow of r1
+          size_t forward = switches[row] ? flows[row + R * col] : flowSums[row];
+          size_t backward = switches[col] ? flows[col + R * row] : flowSums[col];
+          loads[row + R * col] = forward + backward;
+        }
+      });
+    });
+  }
+
+  static size_t CalculateTrafficDifference(const TopologyInput& input, const Flows& loads) {
+    size_t accumulated = 0;
+    Unroll(Sequence(), [&]<size_t row>(Index<row>) {
+      Unroll(Sequence(), [&]<size_t col>(Index<col>) {
+        if constexpr (col > row) {
+          size_t traffic = loads[row + R * col] * 2;
+          size_t bandwidth = input.bandwidthMatrix.At(row, col);
+          accumulated += std::max(traffic, bandwidth) - std::min(traffic, bandwidth);
+        }
+      });
+    });
+
+    return accumulated;
+  }
+
+  static Objectives Evaluate(const TopologyInput& input, const Flows& flows, std::span<const RouterType> routerTypes, std::span<const size_t> membership, Flows& loads) {
+    CreateLoads(flows, routerTypes, loads);
+
+    size_t traffic = 0;
+    Unroll(Sequence(), [&]<size_t row>(Index<row>) {
+      Unroll(Sequence(), [&]<size_t col>(Index<col>) {
+        if constexpr (col > row) {
+          traffic += loads[row + R * col] * 2;
+        }
+      });
+    });
+
+    std::array<size_t, R> hostsCount {};
+    for (size_t router : membership) {
+      ++hostsCount[router];
+    }
+
+    size_t portPenalty = 0;
+    Unroll(Sequence(), [&]<size_t router>(Index<router>) {
+      if (hostsCount[router] > input.portsCount[router]) {
+        portPenalty += hostsCount[router] - input.portsCount[router];
+      }
+    });
+
+    return Objectives { { CalculateTrafficDifference(input, loads), portPenalty, traffic }, input.CalculateDistance(membership) };
+  }
+};
+
+/**
+ * Runtime dispatch to kernels of a fixed set of router counts.
+ */
+struct FixedRouterKernels final {
+  static constexpr size_t kMinRouters = 2;
+  static constexpr size_t kMaxRouters = 16;
+
+  struct Entry final {
+    void (*accumulateFlows)(const TopologyInput&, EvaluationBatch&);
+    void (*evaluateFlows)(const TopologyInput&, EvaluationBatch&, size_t);
+    void (*fillLoadMatrix)(const TopologyInput&, std::span<const size_t>, std::span<const RouterType>, SymmetricalMatrix<size_t>&);
+    size_t (*calculateTrafficDifference)(const TopologyInput&, const SymmetricalMatrix<size_t>&);
+  };
+
+  /**
+   * Returns kernels of the router count or nullptr if there is no specialisation.
+   */
+  static const Entry* Find(size_t routers) {
+    static const auto table = CreateTable(std::make_index_sequence<kMaxRouters - kMinRouters + 1>());
+    if (routers < kMinRouters || routers > kMaxRouters) {
+      return nullptr;
+    }
+
+    return &table[routers - kMinRouters];
+  }
+
+private:
+  template <size_t... I>
+  static constexpr std::array<Entry, sizeof...(I)> CreateTable(std::index_sequence<I...>) {
+    return { {
+      {
+        &FixedRouterKernel<kMinRouters + I>::AccumulateFlows,
+        &FixedRouterKernel<kMinRouters + I>::EvaluateFlows,
+        &FixedRouterKernel<kMinRouters + I>::FillLoadMatrix,
+        &FixedRouterKernel<kMinRouters + I>::CalculateTrafficDifference
+      }...
+    } };
+  }
+};
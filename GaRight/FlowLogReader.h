@@ -0,0 +1,294 @@
+#pragma once
+
+#include "Matrix.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Traffic aggregated from a flow log.
+struct FlowTable final {
+  struct Flow final {
+    size_t source;
+    size_t destination;
+    size_t bytes;
+  };
+
+  /// Host identifiers as they appear in the log, sorted. Index is the dense host id.
+  std::vector<std::string> hosts;
+  /// Total bytes of each (source, destination) pair, sorted by source then destination.
+  std::vector<Flow> flows;
+  size_t lines = 0;
+  /// Lines skipped because they couldn't be parsed, e.g. a header.
+  size_t malformedLines = 0;
+  /// Lines skipped because source and destination are the same host. Evaluators expect a zero diagonal.
+  size_t selfLines = 0;
+
+  /**
+   * Dense traffic matrix. traffic(source, destination) is At(source, destination).
+   */
+  Matrix<size_t> CreateTrafficMatrix() const {
+    Matrix<size_t> result(hosts.size(), hosts.size());
+    for (const auto& flow : flows) {
+      result.At(flow.source, flow.destination) = flow.bytes;
+    }
+
+    return result;
+  }
+
+  /**
+   * Sparse traffic matrix with rows of sources.
+   */
+  SparseMatrix<size_t> CreateSparseTrafficMatrix() const {
+    SparseMatrix<size_t> result(hosts.size());
+    size_t row = 0;
+    for (const auto& flow : flows) {
+      for (; row < flow.source; ++row) {
+        result.EndRow();
+      }
+      result.PushBack(flow.destination, flow.bytes);
+    }
+    for (; row < hosts.size(); ++row) {
+      result.EndRow();
+    }
+
+    return result;
+  }
+};
+
+/**
+ * Streams delimited flow records (source host, destination host, bytes per line) into a FlowTable.
+ * The file is read in large chunks while the previous chunk is parsed, every chunk is split at line boundaries
+ * between threads. Each thread keeps its own host dictionary and pair totals, which are merged once at the end,
+ * so memory depends on the number of distinct hosts and pairs, not on the log size.
+ */
+struct FlowLogReader final {
+  struct Options final {
+    char separator = ',';
+    size_t sourceColumn = 0;
+    size_t destinationColumn = 1;
+    size_t bytesColumn = 2;
+    size_t chunkSize = static_cast<size_t>(64) << 20;
+    size_t threads = Parallel::GetThreadsCount();
+  };
+
+  /**
+   * Returns false if the file can't be opened.
+   */
+  static bool Read(const std::filesystem::path& path, const Options& options, FlowTable& result) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return false;
+    }
+
+    const size_t threads = std::max(options.threads, static_cast<size_t>(1));
+    std::vector<Aggregate> aggregates(threads);
+    std::vector<size_t> blockBegins(threads + 1);
+
+    // Unfinished last line of the previous chunk
+    std::string carry;
+    std::vector<char> current(options.chunkSize);
+    std::vector<char> next(options.chunkSize);
+    size_t currentSize = ReadChunk(file, current);
+
+    while (currentSize != 0) {
+      // Read the next chunk while this one is parsed
+      std::future<size_t> nextSize = std::async(std::launch::async, [&file, &next] {
+        return ReadChunk(file, next);
+      });
+
+      std::string_view chunk(current.data(), currentSize);
+      size_t first = chunk.find('\n');
+      if (first == std::string_view::npos) {
+        carry.append(chunk);
+      }
+      else {
+        carry.append(chunk.substr(0, first));
+        ParseLine(carry, options, aggregates[0]);
+        carry.clear();
+
+        size_t last = chunk.rfind('\n');
+        std::string_view lines = chunk.substr(first + 1, last - first);
+        carry.assign(chunk.substr(last + 1));
+
+        // Blocks start right after a line break
+        for (size_t block = 0; block <= threads; ++block) {
+          size_t begin = Parallel::BlockBegin(lines.size(), threads, block);
+          if (begin != 0 && block != threads) {
+            size_t lineBreak = lines.find('\n', begin - 1);
+            begin = lineBreak == std::string_view::npos ? lines.size() : lineBreak + 1;
+          }
+          blockBegins[block] = std::max(begin, block == 0 ? 0 : blockBegins[block - 1]);
+        }
+
+        Parallel::ForBlocks(threads, threads, [&](size_t, size_t, size_t block) {
+          ParseLines(lines.substr(blockBegins[block], blockBegins[block + 1] - blockBegins[block]), options, aggregates[block]);
+        });
+      }
+
+      currentSize = nextSize.get();
+      std::swap(current, next);
+    }
+
+    if (!carry.empty()) {
+      ParseLine(carry, options, aggregates[0]);
+    }
+
+    Merge(aggregates, result);
+    return true;
+  }
+
+private:
+  /// Allows looking up std::string keys by std::string_view.
+  struct StringHash final {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view value) const {
+      return std::hash<std::string_view>()(value);
+    }
+  };
+
+  /// Per-thread state. Host ids are local to the thread until Merge.
+  struct Aggregate final {
+    std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> hostIds;
+    /// (local source << 32 | local destination) -> bytes
+    std::unordered_map<uint64_t, size_t> pairs;
+    size_t lines = 0;
+    size_t malformedLines = 0;
+    size_t selfLines = 0;
+  };
+
+  static size_t ReadChunk(std::ifstream& file, std::vector<char>& buffer) {
+    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<size_t>(file.gcount());
+  }
+
+  static void ParseLines(std::string_view lines, const Options& options, Aggregate& aggregate) {
+    while (!lines.empty()) {
+      size_t end = lines.find('\n');
+      ParseLine(lines.substr(0, end), options, aggregate);
+      lines.remove_prefix(end == std::string_view::npos ? lines.size() : end + 1);
+    }
+  }
+
+  static void ParseLine(std::string_view line, const Options& options, Aggregate& aggregate) {
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (line.empty()) {
+      return;
+    }
+    ++aggregate.lines;
+
+    std::string_view source;
+    std::string_view destination;
+    std::string_view bytesField;
+    size_t column = 0;
+    while (true) {
+      size_t end = line.find(options.separator);
+      std::string_view field = line.substr(0, end);
+      if (column == options.sourceColumn) {
+        source = field;
+      }
+      if (column == options.destinationColumn) {
+        destination = field;
+      }
+      if (column == options.bytesColumn) {
+        bytesField = field;
+      }
+
+      if (end == std::string_view::npos) {
+        break;
+      }
+      line.remove_prefix(end + 1);
+      ++column;
+    }
+
+    size_t bytes = 0;
+    auto [last, error] = std::from_chars(bytesField.data(), bytesField.data() + bytesField.size(), bytes);
+    if (source.empty() || destination.empty() || bytesField.empty() || error != std::errc() || last != bytesField.data() + bytesField.size()) {
+      ++aggregate.malformedLines;
+      return;
+    }
+    // The host still needs a gateway, only its traffic is dropped
+    if (source == destination) {
+      GetHostId(aggregate, source);
+      ++aggregate.selfLines;
+      return;
+    }
+
+    uint64_t key = static_cast<uint64_t>(GetHostId(aggregate, source)) << 32 | GetHostId(aggregate, destination);
+    aggregate.pairs[key] += bytes;
+  }
+
+  static size_t GetHostId(Aggregate& aggregate, std::string_view host) {
+    auto it = aggregate.hostIds.find(host);
+    if (it == aggregate.hostIds.end()) {
+      it = aggregate.hostIds.emplace(std::string(host), aggregate.hostIds.size()).first;
+    }
+
+    return it->second;
+  }
+
+  /**
+   * Maps local host ids to global ones and sums pair totals of all threads.
+   * Global ids follow the sorted host names, so they don't depend on threads, chunks or hash map order.
+   */
+  static void Merge(std::vector<Aggregate>& aggregates, FlowTable& result) {
+    result.hosts.clear();
+    result.flows.clear();
+    result.lines = 0;
+    result.malformedLines = 0;
+    result.selfLines = 0;
+
+    for (const auto& aggregate : aggregates) {
+      for (const auto& [host, localId] : aggregate.hostIds) {
+        result.hosts.emplace_back(host);
+      }
+    }
+    std::ranges::sort(result.hosts);
+    result.hosts.erase(std::unique(result.hosts.begin(), result.hosts.end()), result.hosts.end());
+
+    std::vector<size_t> globalIds;
+    for (auto& aggregate : aggregates) {
+      globalIds.resize(aggregate.hostIds.size());
+      for (const auto& [host, localId] : aggregate.hostIds) {
+        globalIds[localId] = std::ranges::lower_bound(result.hosts, host) - result.hosts.begin();
+      }
+
+      for (const auto& [key, bytes] : aggregate.pairs) {
+        result.flows.emplace_back(FlowTable::Flow { globalIds[key >> 32], globalIds[key & 0xFFFFFFFF], bytes });
+      }
+
+      result.lines += aggregate.lines;
+      result.malformedLines += aggregate.malformedLines;
+      result.selfLines += aggregate.selfLines;
+      aggregate = Aggregate();
+    }
+
+    std::ranges::sort(result.flows, [](const FlowTable::Flow& lhs, const FlowTable::Flow& rhs) {
+      return lhs.source != rhs.source ? lhs.source < rhs.source : lhs.destination < rhs.destination;
+    });
+
+    // The same pair may come from several threads
+    size_t size = 0;
+    for (const auto& flow : result.flows) {
+      if (size != 0 && result.flows[size - 1].source == flow.source && result.flows[size - 1].destination == flow.destination) {
+        result.flows[size - 1].bytes += flow.bytes;
+      }
+      else {
+        result.flows[size++] = flow;
+      }
+    }
+    result.flows.resize(size);
+  }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "BatchEvaluator.h"
+#include "GeneticOperators.h"
+#include "GraphPartitioner.h"
+#include "Individual.h"
+#include "TopologyGenerator.h"
+
+#include <array>
+#include <vector>
+
+/**
+ * Double-buffered storage of two generations.
+ * Offspring of generation g + 1 are written over the individuals of generation g - 1, so membership tables,
+ * subnetwork tables and load matrices are recycled wholesale instead of being freed and allocated again.
+ * Selection scratch buffers and the evaluation batch are sized once for the population.
+ * Repair of sparse traffic reads peers of evicted hosts from the traffic graph built once for the input.
+ */
+struct GenerationArena final {
+  explicit GenerationArena(std::vector<Individual> population)
+    : m_buffers { population, std::move(population) }
+    , m_current(0) {
+    m_probabilities.reserve(m_buffers[0].size());
+    m_parents.reserve(m_buffers[0].size());
+  }
+
+  /**
+   * Same as above, also sizes the evaluation batch for the population and builds the traffic graph for repair.
+   */
+  explicit GenerationArena(std::vector<Individual> population, const TopologyInput& input)
+    : GenerationArena(std::move(population)) {
+    m_batch.Resize(m_buffers[0].size(), input.hosts, input.routers, input.epochs.IsPerEpoch() ? input.epochs.count : 0);
+    UpdateTrafficGraph(input);
+  }
+
+  /**
+   * Rebuilds the traffic graph of repair after the traffic matrix changed.
+   * Dense traffic gets none, every evicted host reads its whole row either way.
+   */
+  void UpdateTrafficGraph(const TopologyInput& input) {
+    m_repairBuffers.trafficGraph = GraphPartitioner::CreateTrafficGraph(input.trafficMatrix);
+    if (m_repairBuffers.trafficGraph.GetNonZeroCount() > input.hosts * input.hosts / kMaxGraphDensity) {
+      m_repairBuffers.trafficGraph = SparseMatrix<size_t>();
+    }
+  }
+
+  std::vector<Individual>& GetCurrent() {
+    return m_buffers[m_current];
+  }
+
+  const std::vector<Individual>& GetCurrent() const {
+    return m_buffers[m_current];
+  }
+
+  /**
+   * Returns the buffer that receives the next generation. Its contents are stale.
+   */
+  std::vector<Individual>& GetNext() {
+    return m_buffers[1 - m_current];
+  }
+
+  /**
+   * Makes the next generation current and recycles the current one.
+   */
+  void Flip() {
+    m_current = 1 - m_current;
+  }
+
+  std::vector<double>& GetProbabilities() {
+    return m_probabilities;
+  }
+
+  std::vector<size_t>& GetParents() {
+    return m_parents;
+  }
+
+  TopologyGenerator::RepairBuffers& GetRepairBuffers() {
+    return m_repairBuffers;
+  }
+
+  GeneticOperators::Buffers& GetOperatorBuffers() {
+    return m_operatorBuffers;
+  }
+
+  EvaluationBatch& GetBatch() {
+    return m_batch;
+  }
+
+private:
+  /// Graph is kept if at most 1 / kMaxGraphDensity of host pairs exchange traffic.
+  static constexpr size_t kMaxGraphDensity = 4;
+
+  std::array<std::vector<Individual>, 2> m_buffers;
+  size_t m_current;
+  std::vector<double> m_probabilities;
+  std::vector<size_t> m_parents;
+  TopologyGenerator::RepairBuffers m_repairBuffers;
+  GeneticOperators::Buffers m_operatorBuffers;
+  EvaluationBatch m_batch;
+};
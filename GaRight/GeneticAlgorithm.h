@@ -0,0 +1,322 @@
+#pragma once
+
+#include "AllocationCounter.h"
+#include "BatchEvaluator.h"
+#include "EvaluationVerifier.h"
+#include "GenerationArena.h"
+#include "GeneticOperators.h"
+#include "Individual.h"
+#include "OperatorBandit.h"
+#include "PopulationSeeding.h"
+#include "Topology.h"
+#include "TrafficDelta.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+struct GreaterFitnessComparator {
+  bool operator()(const Individual& lhs, const Individual& rhs) const {
+    return lhs.GetFitness() > rhs.GetFitness();
+  }
+};
+
+/**
+ * Single-objective genetic algorithm. Roulette selection, uniform crossover, random-reset mutation.
+ * With adaptive operators every offspring gets a crossover and mutation variant pair chosen by a bandit rewarded with the improvement over the better parent.
+ * Population is kept sorted by fitness, best first.
+ */
+struct GeneticAlgorithm final {
+  struct Options final {
+    size_t populationSize;
+    double mutationProbability;
+    SeedingOptions seeding;
+    /// Share of evaluations re-checked by the reference evaluator. Mismatch aborts the run.
+    double verificationRate = 0.0;
+    /// Chooses operator variants per offspring instead of uniform crossover and random-reset mutation.
+    bool adaptiveOperators = false;
+    OperatorBandit::Options operatorSelection;
+  };
+
+  /// Durations of the last Step phases in nanoseconds.
+  struct StepTimings final {
+    uint64_t selection;
+    uint64_t recombination;
+    uint64_t evaluation;
+    uint64_t sorting;
+  };
+
+  explicit GeneticAlgorithm(const TopologyInput& input, TopologyRandom& random, const Options& options)
+    : m_input(input)
+    , m_random(random)
+    , m_options(options)
+    , m_generation(0)
+    , m_stepAllocations(0)
+    , m_meanFitness(0.0)
+    , m_timings()
+    , m_verifier(options.verificationRate)
+    , m_operatorBandit(kCrossoversCount * kMutationsCount, options.operatorSelection)
+    , m_choices(options.populationSize)
+    , m_arena(CreatePopulation(input, random, options), input) {
+    UpdateMeanFitness();
+  }
+
+  /**
+   * Warm start from configurations of a previous run, whose loads were computed before the traffic changed by delta.
+   * The delta must already be applied to input, see TopologyInput::ApplyTrafficDelta.
+   * Missing individuals are random, extra ones are dropped.
+   */
+  explicit GeneticAlgorithm(const TopologyInput& input, TopologyRandom& random, const Options& options, std::vector<TopologyConfiguration> previous, const TrafficDelta& delta)
+    : m_input(input)
+    , m_random(random)
+    , m_options(options)
+    , m_generation(0)
+    , m_stepAllocations(0)
+    , m_meanFitness(0.0)
+    , m_timings()
+    , m_verifier(options.verificationRate)
+    , m_operatorBandit(kCrossoversCount * kMutationsCount, options.operatorSelection)
+    , m_choices(options.populationSize)
+    , m_arena(CreatePopulation(input, random, options, std::move(previous), delta), input) {
+    UpdateMeanFitness();
+  }
+
+  /**
+   * Re-scores the current population after the input traffic changed by delta (see TopologyInput::ApplyTrafficDelta) and keeps evolving it.
+   */
+  void Rescore(const TrafficDelta& delta) {
+    m_arena.UpdateTrafficGraph(m_input);
+    auto& population = m_arena.GetCurrent();
+    for (auto& individual : population) {
+      individual.Rescore(delta);
+      m_verifier.Sample(m_input, individual);
+    }
+    std::ranges::sort(population, GreaterFitnessComparator());
+    UpdateMeanFitness();
+  }
+
+  /**
+   * Replaces the population with the next generation.
+   */
+  void Step() {
+    size_t allocations = AllocationCounter::GetAllocations();
+    auto start = std::chrono::steady_clock::now();
+    SelectParents();
+    auto selected = std::chrono::steady_clock::now();
+
+    const auto& current = m_arena.GetCurrent();
+    const auto& parents = m_arena.GetParents();
+    auto& next = m_arena.GetNext();
+    auto& batch = m_arena.GetBatch();
+    for (size_t i = 0; i < next.size(); ++i) {
+      size_t pair = i - i % 2;
+      const Individual& lhs = current[parents[pair]];
+      const Individual& rhs = current[parents[std::min(pair + 1, parents.size() - 1)]];
+      OperatorChoice& choice = m_choices[i];
+      if (m_options.adaptiveOperators) {
+        size_t arm = m_operatorBandit.Select();
+        choice.crossover = static_cast<CrossoverOperator>(arm / kMutationsCount);
+        choice.mutation = static_cast<MutationOperator>(arm % kMutationsCount);
+        choice.parentFitness = std::max(lhs.GetFitness(), rhs.GetFitness());
+        auto begin = std::chrono::steady_clock::now();
+        next[i].RecombineTables(lhs, rhs, m_options.mutationProbability, choice.crossover, choice.mutation, m_arena.GetRepairBuffers(), m_arena.GetOperatorBuffers());
+        choice.nanoseconds = ToNanoseconds(std::chrono::steady_clock::now() - begin);
+      }
+      else {
+        next[i].RecombineTables(lhs, rhs, m_options.mutationProbability, choice.crossover, choice.mutation, m_arena.GetRepairBuffers(), m_arena.GetOperatorBuffers());
+      }
+      batch.Store(i, next[i].GetConfiguration().membershipTable, next[i].GetConfiguration().routerTypeTable);
+    }
+    auto recombined = std::chrono::steady_clock::now();
+
+    // Evaluate the whole generation at once
+    BatchEvaluator::Evaluate(m_input, batch);
+    for (size_t i = 0; i < next.size(); ++i) {
+      next[i].AssignEvaluation(batch.GetLoads(i), batch.objectives[i]);
+    }
+    if (m_options.adaptiveOperators) {
+      RewardOperators(ToNanoseconds(std::chrono::steady_clock::now() - recombined) / next.size());
+    }
+    if (m_verifier.IsEnabled()) {
+      for (const auto& individual : next) {
+        m_verifier.Sample(m_input, individual);
+      }
+    }
+    auto evaluated = std::chrono::steady_clock::now();
+
+    m_arena.Flip();
+    std::ranges::sort(m_arena.GetCurrent(), GreaterFitnessComparator());
+    UpdateMeanFitness();
+    ++m_generation;
+    auto sorted = std::chrono::steady_clock::now();
+
+    m_timings = StepTimings {
+      ToNanoseconds(selected - start),
+      ToNanoseconds(recombined - selected),
+      ToNanoseconds(evaluated - recombined),
+      ToNanoseconds(sorted - evaluated)
+    };
+    m_stepAllocations = AllocationCounter::GetAllocations() - allocations;
+  }
+
+  const Individual& GetBest() const {
+    return m_arena.GetCurrent().front();
+  }
+
+  const std::vector<Individual>& GetPopulation() const {
+    return m_arena.GetCurrent();
+  }
+
+  size_t GetGeneration() const {
+    return m_generation;
+  }
+
+  double GetMeanFitness() const {
+    return m_meanFitness;
+  }
+
+  /**
+   * Returns the number of heap allocations made by the last Step. Zero once the run reaches steady state.
+   */
+  size_t GetStepAllocations() const {
+    return m_stepAllocations;
+  }
+
+  const StepTimings& GetStepTimings() const {
+    return m_timings;
+  }
+
+  double GetMutationProbability() const {
+    return m_options.mutationProbability;
+  }
+
+  /**
+   * Takes effect from the next Step.
+   */
+  void SetMutationProbability(double probability) {
+    m_options.mutationProbability = probability;
+  }
+
+  /**
+   * Returns the share of recent offspring made with the crossover variant.
+   */
+  double GetOperatorShare(CrossoverOperator crossover) const {
+    double share = 0.0;
+    for (size_t mutation = 0; mutation < kMutationsCount; ++mutation) {
+      share += m_operatorBandit.GetShare(static_cast<size_t>(crossover) * kMutationsCount + mutation);
+    }
+    return share;
+  }
+
+  /**
+   * Returns the share of recent offspring made with the mutation variant.
+   */
+  double GetOperatorShare(MutationOperator mutation) const {
+    double share = 0.0;
+    for (size_t crossover = 0; crossover < kCrossoversCount; ++crossover) {
+      share += m_operatorBandit.GetShare(crossover * kMutationsCount + static_cast<size_t>(mutation));
+    }
+    return share;
+  }
+
+private:
+  static constexpr size_t kCrossoversCount = static_cast<size_t>(CrossoverOperator::COUNT);
+  static constexpr size_t kMutationsCount = static_cast<size_t>(MutationOperator::COUNT);
+
+  /// Operator variants an offspring was made with.
+  struct OperatorChoice final {
+    CrossoverOperator crossover = CrossoverOperator::UNIFORM;
+    MutationOperator mutation = MutationOperator::RANDOM_RESET;
+    double parentFitness = 0.0;
+    uint64_t nanoseconds = 0;
+  };
+
+  static uint64_t ToNanoseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  }
+
+  static std::vector<Individual> CreatePopulation(const TopologyInput& input, TopologyRandom& random, const Options& options) {
+    std::vector<Individual> population = PopulationSeeding::CreatePopulation(input, random, options.populationSize, options.seeding);
+    std::ranges::sort(population, GreaterFitnessComparator());
+
+    return population;
+  }
+
+  static std::vector<Individual> CreatePopulation(const TopologyInput& input, TopologyRandom& random, const Options& options, std::vector<TopologyConfiguration> previous, const TrafficDelta& delta) {
+    std::vector<Individual> population;
+    population.reserve(options.populationSize);
+    for (size_t i = 0; i < previous.size() && population.size() < options.populationSize; ++i) {
+      previous[i].ApplyTrafficDelta(input, delta);
+      population.emplace_back(input, random, previous[i]);
+    }
+    while (population.size() < options.populationSize) {
+      population.emplace_back(input, random);
+    }
+    std::ranges::sort(population, GreaterFitnessComparator());
+
+    return population;
+  }
+
+  void UpdateMeanFitness() {
+    const auto& population = m_arena.GetCurrent();
+    m_meanFitness = std::accumulate(population.begin(), population.end(), 0.0, [](double old, const Individual& v) {
+      return old + v.GetFitness();
+    }) / population.size();
+  }
+
+  /**
+   * Rewards the operator pair of every offspring with its relative improvement over the better parent.
+   * Cost is the recombination time plus an equal share of the batch evaluation time.
+   */
+  void RewardOperators(uint64_t evaluationNanoseconds) {
+    const auto& next = m_arena.GetNext();
+    for (size_t i = 0; i < next.size(); ++i) {
+      const OperatorChoice& choice = m_choices[i];
+      double improvement = choice.parentFitness > 0.0 ? std::max(next[i].GetFitness() - choice.parentFitness, 0.0) / choice.parentFitness : 0.0;
+      double microseconds = static_cast<double>(choice.nanoseconds + evaluationNanoseconds) / 1000.0;
+      m_operatorBandit.Reward(static_cast<size_t>(choice.crossover) * kMutationsCount + static_cast<size_t>(choice.mutation), improvement, microseconds);
+    }
+    m_operatorBandit.Discount();
+  }
+
+  /**
+   * Roulette selection of parent indices, shuffled into pairs.
+   */
+  void SelectParents() {
+    const auto& population = m_arena.GetCurrent();
+    double fitnessSum = std::accumulate(population.begin(), population.end(), 0.0, [](double old, const Individual& v) {
+      return old + v.GetFitness();
+    });
+
+    auto& probabilities = m_arena.GetProbabilities();
+    probabilities.clear();
+    double accumulated = 0.0;
+    for (const auto& v : population) {
+      accumulated += v.GetFitness() / fitnessSum;
+      probabilities.emplace_back(accumulated);
+    }
+
+    auto& parents = m_arena.GetParents();
+    parents.clear();
+    for (size_t i = 0; i < population.size(); ++i) {
+      // Rounding may leave the last probability slightly below 1
+      size_t selected = std::ranges::lower_bound(probabilities, m_random.dist(m_random.rng)) - probabilities.begin();
+      parents.emplace_back(std::min(selected, population.size() - 1));
+    }
+    std::ranges::shuffle(parents, m_random.rng);
+  }
+
+  const TopologyInput& m_input;
+  TopologyRandom& m_random;
+  Options m_options;
+  size_t m_generation;
+  size_t m_stepAllocations;
+  double m_meanFitness;
+  StepTimings m_timings;
+  EvaluationVerifier m_verifier;
+  OperatorBandit m_operatorBandit;
+  std::vector<OperatorChoice> m_choices;
+  GenerationArena m_arena;
+};
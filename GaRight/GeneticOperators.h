@@ -0,0 +1,227 @@
+#pragma once
+
+#include "Topology.h"
+#include "TopologyGenerator.h"
+#include "TopologyInput.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+enum class CrossoverOperator {
+  /// Every gene from a random parent
+  UNIFORM,
+  /// Genes before a random cut from one parent, after it - from the other
+  ONE_POINT,
+  /// Genes between two random cuts from the second parent
+  TWO_POINT,
+  /// Whole subnetworks of routers, each router inherited from a random parent
+  SUBNETWORK,
+  COUNT
+};
+
+enum class MutationOperator {
+  /// Random gateway and router type per gene
+  RANDOM_RESET,
+  /// Swaps gateways of two hosts, keeps subnetwork sizes
+  SWAP,
+  /// Flips router types only
+  ROUTER_TYPE,
+  /// Moves host to the router it exchanges most traffic with
+  BUSIEST_PEER,
+  COUNT
+};
+
+/**
+ * Crossover and mutation variants. All of them write membership and router type tables only,
+ * derived tables are left stale until Update, port limits until RepairTables.
+ */
+struct GeneticOperators final {
+  /// Scratch reused between calls.
+  struct Buffers final {
+    std::vector<uint8_t> owners;
+    std::vector<uint64_t> priorities;
+    std::vector<size_t> affinity;
+  };
+
+  static const char* GetName(CrossoverOperator op) {
+    static constexpr const char* kNames[] = { "uniform", "one-point", "two-point", "subnetwork" };
+    return kNames[static_cast<size_t>(op)];
+  }
+
+  static const char* GetName(MutationOperator op) {
+    static constexpr const char* kNames[] = { "random reset", "swap", "router type", "busiest peer" };
+    return kNames[static_cast<size_t>(op)];
+  }
+
+  static void Cross(CrossoverOperator op, const TopologyInput& input, const TopologyConfiguration& lhs, const TopologyConfiguration& rhs, TopologyRandom& random, Buffers& buffers, TopologyConfiguration& result) {
+    assert(&result != &lhs && &result != &rhs);
+    result.membershipTable.resize(input.hosts);
+    result.routerTypeTable.resize(input.routers);
+
+    switch (op) {
+      case CrossoverOperator::ONE_POINT:
+        CrossOnePoint(lhs.membershipTable, rhs.membershipTable, random, result.membershipTable);
+        CrossOnePoint(lhs.routerTypeTable, rhs.routerTypeTable, random, result.routerTypeTable);
+        break;
+      case CrossoverOperator::TWO_POINT:
+        CrossTwoPoint(lhs.membershipTable, rhs.membershipTable, random, result.membershipTable);
+        CrossTwoPoint(lhs.routerTypeTable, rhs.routerTypeTable, random, result.routerTypeTable);
+        break;
+      case CrossoverOperator::SUBNETWORK:
+        CrossSubnetworks(input, lhs, rhs, random, buffers, result);
+        break;
+      default:
+        TopologyConfiguration::CrossTables(input, lhs, rhs, random, result);
+        break;
+    }
+  }
+
+  static void Mutate(MutationOperator op, const TopologyInput& input, double probability, TopologyRandom& random, Buffers& buffers, TopologyConfiguration& conf) {
+    switch (op) {
+      case MutationOperator::SWAP:
+        MutateSwap(input, probability, random, conf);
+        break;
+      case MutationOperator::ROUTER_TYPE:
+        MutateRouterTypes(input, probability, random, conf);
+        break;
+      case MutationOperator::BUSIEST_PEER:
+        MutateBusiestPeer(input, probability, random, buffers, conf);
+        break;
+      default:
+        TopologyConfiguration::MutateTables(input, probability, random, conf);
+        break;
+    }
+  }
+
+private:
+  template <typename T>
+  static void CrossOnePoint(const std::vector<T>& lhs, const std::vector<T>& rhs, TopologyRandom& random, std::vector<T>& result) {
+    const size_t size = result.size();
+    size_t cut = random.rng() % (size + 1);
+    std::copy(lhs.begin(), lhs.begin() + cut, result.begin());
+    std::copy(rhs.begin() + cut, rhs.begin() + size, result.begin() + cut);
+  }
+
+  template <typename T>
+  static void CrossTwoPoint(const std::vector<T>& lhs, const std::vector<T>& rhs, TopologyRandom& random, std::vector<T>& result) {
+    const size_t size = result.size();
+    size_t first = random.rng() % (size + 1);
+    size_t second = random.rng() % (size + 1);
+    if (first > second) {
+      std::swap(first, second);
+    }
+    std::copy(lhs.begin(), lhs.begin() + size, result.begin());
+    std::copy(rhs.begin() + first, rhs.begin() + second, result.begin() + first);
+  }
+
+  /**
+   * Each router and its subnetwork is owned by a random parent. A host joins the subnetwork that claims it:
+   * the higher priority one if both parents' routers claim it, a random parent's one if none does.
+   */
+  static void CrossSubnetworks(const TopologyInput& input, const TopologyConfiguration& lhs, const TopologyConfiguration& rhs, TopologyRandom& random, Buffers& buffers, TopologyConfiguration& result) {
+    auto& owners = buffers.owners;
+    auto& priorities = buffers.priorities;
+    owners.resize(input.routers);
+    priorities.resize(input.routers);
+    for (size_t router = 0; router < input.routers; ++router) {
+      uint64_t bits = random.rng();
+      owners[router] = static_cast<uint8_t>(bits & 1);
+      priorities[router] = bits >> 1;
+      result.routerTypeTable[router] = owners[router] == 0 ? lhs.routerTypeTable[router] : rhs.routerTypeTable[router];
+    }
+
+    for (size_t host = 0; host < input.hosts; ++host) {
+      size_t left = lhs.membershipTable[host];
+      size_t right = rhs.membershipTable[host];
+      bool leftClaims = owners[left] == 0;
+      bool rightClaims = owners[right] == 1;
+      if (leftClaims && rightClaims) {
+        result.membershipTable[host] = priorities[left] >= priorities[right] ? left : right;
+      }
+      else if (leftClaims || rightClaims) {
+        result.membershipTable[host] = leftClaims ? left : right;
+      }
+      else {
+        result.membershipTable[host] = random.dist(random.rng) > 0.5 ? left : right;
+      }
+    }
+  }
+
+  static bool IsAllowed(const TopologyInput& input, size_t host, size_t router) {
+    if (input.candidates.IsEmpty()) {
+      return true;
+    }
+    auto candidates = input.candidates.Get(host);
+    return std::ranges::find(candidates, router) != candidates.end();
+  }
+
+  static void MutateSwap(const TopologyInput& input, double probability, TopologyRandom& random, TopologyConfiguration& conf) {
+    auto& membership = conf.membershipTable;
+    for (size_t i = 0; i < input.hosts; ++i) {
+      if (random.dist(random.rng) <= probability) {
+        size_t j = random.rng() % input.hosts;
+        if (IsAllowed(input, i, membership[j]) && IsAllowed(input, j, membership[i])) {
+          std::swap(membership[i], membership[j]);
+        }
+      }
+    }
+
+    for (size_t i = 0; i < input.routers; ++i) {
+      if (random.dist(random.rng) <= probability) {
+        std::swap(conf.routerTypeTable[i], conf.routerTypeTable[random.rng() % input.routers]);
+      }
+    }
+  }
+
+  static void MutateRouterTypes(const TopologyInput& input, double probability, TopologyRandom& random, TopologyConfiguration& conf) {
+    constexpr size_t types = static_cast<size_t>(RouterType::COUNT);
+    for (size_t i = 0; i < input.routers; ++i) {
+      if (random.dist(random.rng) <= probability) {
+        size_t type = static_cast<size_t>(conf.routerTypeTable[i]);
+        conf.routerTypeTable[i] = static_cast<RouterType>((type + 1 + random.rng() % (types - 1)) % types);
+      }
+    }
+  }
+
+  /**
+   * Moves hosts to the allowed router with the largest two-sided traffic between the host and the router's subnetwork. O(hosts + routers) per move.
+   */
+  static void MutateBusiestPeer(const TopologyInput& input, double probability, TopologyRandom& random, Buffers& buffers, TopologyConfiguration& conf) {
+    const size_t hosts = input.hosts;
+    const size_t* traffic = input.trafficMatrix.GetData().data();
+    auto& membership = conf.membershipTable;
+    auto& affinity = buffers.affinity;
+
+    for (size_t host = 0; host < hosts; ++host) {
+      if (random.dist(random.rng) > probability) {
+        continue;
+      }
+
+      affinity.assign(input.routers, 0);
+      const size_t* column = traffic + hosts * host;
+      for (size_t peer = 0; peer < hosts; ++peer) {
+        if (peer != host) {
+          affinity[membership[peer]] += column[peer] + traffic[hosts * peer + host];
+        }
+      }
+
+      auto better = [&](size_t router, size_t best) {
+        return affinity[router] > affinity[best];
+      };
+      size_t best = membership[host];
+      if (input.candidates.IsEmpty()) {
+        for (size_t router = 0; router < input.routers; ++router) {
+          best = better(router, best) ? router : best;
+        }
+      }
+      else {
+        for (size_t router : input.candidates.Get(host)) {
+          best = better(router, best) ? router : best;
+        }
+      }
+      membership[host] = best;
+    }
+  }
+};
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "Matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/**
+ * Multilevel k-way partitioner of the host traffic graph. Edge weight of hosts a and b is traffic(a, b) + traffic(b, a).
+ * 1. Coarsening: vertices are merged along the heaviest edge of a random matching until the graph is small.
+ * 2. Initial partition: greedy growing of the coarsest graph, the best of several randomised trials is kept.
+ * 3. Uncoarsening: the partition is projected back level by level and refined by greedy k-way FM moves.
+ * Part p is the subnetwork of router p, its size limit is the share of hosts proportional to portsCount[p].
+ */
+struct GraphPartitioner final {
+  struct Options final {
+    /// Allowed excess of part size over its proportional share.
+    double imbalance = 0.03;
+    /// Coarsening stops at this many vertices per part.
+    size_t coarsestVerticesPerPart = 16;
+    /// Randomised initial partitions of the coarsest graph.
+    size_t initialTrials = 4;
+    /// Upper bound of refinement passes per level.
+    size_t refinementPasses = 8;
+  };
+
+  /**
+   * Returns part of every host, i.e. membership table.
+   */
+  static std::vector<size_t> Partition(const Matrix<size_t>& trafficMatrix, const std::vector<size_t>& portsCount, const Options& options, std::mt19937_64& rng) {
+    const size_t hosts = trafficMatrix.GetWidth();
+    const size_t parts = portsCount.size();
+    if (parts <= 1 || hosts == 0) {
+      return std::vector<size_t>(hosts, 0);
+    }
+
+    std::vector<size_t> limits = CreateLimits(hosts, portsCount, options.imbalance);
+    size_t maxVertexWeight = std::max<size_t>(1, hosts * 3 / (2 * parts * options.coarsestVerticesPerPart));
+
+    // levels[0] is the host graph, every next one is coarser
+    std::vector<Level> levels;
+    levels.emplace_back(CreateHostGraph(trafficMatrix));
+    while (levels.back().GetSize() > parts * options.coarsestVerticesPerPart) {
+      Level coarse = Coarsen(levels.back(), maxVertexWeight, rng);
+      if (coarse.GetSize() * 20 > levels.back().GetSize() * 19) {
+        break;
+      }
+      levels.emplace_back(std::move(coarse));
+    }
+
+    std::vector<size_t> partition;
+    size_t bestCut = std::numeric_limits<size_t>::max();
+    for (size_t trial = 0; trial < std::max<size_t>(1, options.initialTrials); ++trial) {
+      std::vector<size_t> candidate = CreateInitialPartition(levels.back(), limits, rng);
+      Refine(levels.back(), limits, options.refinementPasses, candidate, rng);
+      size_t cut = CalculateCut(levels.back(), candidate);
+      if (cut < bestCut) {
+        bestCut = cut;
+        partition = std::move(candidate);
+      }
+    }
+
+    for (size_t i = levels.size() - 1; i-- > 0;) {
+      std::vector<size_t> projected(levels[i].GetSize());
+      for (size_t vertex = 0; vertex < projected.size(); ++vertex) {
+        projected[vertex] = partition[levels[i].coarseMap[vertex]];
+      }
+      partition = std::move(projected);
+      Refine(levels[i], limits, options.refinementPasses, partition, rng);
+    }
+
+    return partition;
+  }
+
+  /**
+   * Symmetric adjacency of hosts with weights traffic(a, b) + traffic(b, a), no self loops.
+   */
+  static SparseMatrix<size_t> CreateTrafficGraph(const Matrix<size_t>& trafficMatrix) {
+    const size_t hosts = trafficMatrix.GetWidth();
+    SparseMatrix<size_t> result(hosts);
+    for (size_t row = 0; row < hosts; ++row) {
+      for (size_t col = 0; col < hosts; ++col) {
+        size_t weight = trafficMatrix.At(row, col) + trafficMatrix.At(col, row);
+        if (row != col && weight != 0) {
+          result.PushBack(col, weight);
+        }
+      }
+      result.EndRow();
+    }
+
+    return result;
+  }
+
+private:
+  /// Graph of a single coarsening level.
+  struct Level final {
+    /// Symmetric adjacency with edge weights, no self loops.
+    SparseMatrix<size_t> edges;
+    /// Number of hosts merged into each vertex.
+    std::vector<size_t> weights;
+    /// Vertex of the next coarser level containing each vertex.
+    std::vector<size_t> coarseMap;
+
+    size_t GetSize() const {
+      return weights.size();
+    }
+  };
+
+  /**
+   * Proportional share of hosts, capped by ports when there are enough of them.
+   */
+  static std::vector<size_t> CreateLimits(size_t hosts, const std::vector<size_t>& portsCount, double imbalance) {
+    size_t totalPorts = std::accumulate(portsCount.begin(), portsCount.end(), static_cast<size_t>(0));
+    std::vector<size_t> result(portsCount.size());
+    for (size_t part = 0; part < portsCount.size(); ++part) {
+      double share = totalPorts == 0
+        ? static_cast<double>(hosts) / portsCount.size()
+        : static_cast<double>(hosts) * portsCount[part] / totalPorts;
+      result[part] = static_cast<size_t>(std::ceil(share * (1.0 + imbalance)));
+      if (totalPorts >= hosts) {
+        result[part] = std::max(std::min(result[part], portsCount[part]), static_cast<size_t>(std::ceil(share)));
+      }
+    }
+
+    return result;
+  }
+
+  static Level CreateHostGraph(const Matrix<size_t>& trafficMatrix) {
+    const size_t hosts = trafficMatrix.GetWidth();
+    return Level { CreateTrafficGraph(trafficMatrix), std::vector<size_t>(hosts, 1), {} };
+  }
+
+  /**
+   * Heavy-edge matching in random order. Writes fine -> coarse mapping into fine.coarseMap.
+   */
+  static Level Coarsen(Level& fine, size_t maxVertexWeight, std::mt19937_64& rng) {
+    constexpr size_t kUnmatched = std::numeric_limits<size_t>::max();
+    const size_t size = fine.GetSize();
+    const auto& offsets = fine.edges.GetOffsets();
+    const auto& columns = fine.edges.GetColumns();
+    const auto& values = fine.edges.GetValues();
+
+    std::vector<size_t> order(size);
+    std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+    std::ranges::shuffle(order, rng);
+
+    std::vector<size_t> match(size, kUnmatched);
+    for (size_t vertex : order) {
+      if (match[vertex] != kUnmatched) {
+        continue;
+      }
+
+      size_t best = vertex;
+      size_t bestWeight = 0;
+      for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+        size_t neighbour = columns[i];
+        if (match[neighbour] == kUnmatched && values[i] > bestWeight && fine.weights[vertex] + fine.weights[neighbour] <= maxVertexWeight) {
+          best = neighbour;
+          bestWeight = values[i];
+        }
+      }
+      match[vertex] = best;
+      match[best] = vertex;
+    }
+
+    size_t coarseSize = 0;
+    fine.coarseMap.assign(size, 0);
+    for (size_t vertex = 0; vertex < size; ++vertex) {
+      if (vertex <= match[vertex]) {
+        fine.coarseMap[vertex] = coarseSize;
+        fine.coarseMap[match[vertex]] = coarseSize;
+        ++coarseSize;
+      }
+    }
+
+    // Merge adjacency of matched pairs, accumulating weights of shared neighbours
+    Level result { SparseMatrix<size_t>(coarseSize), std::vector<size_t>(coarseSize, 0), {} };
+    std::vector<size_t> accumulated(coarseSize, 0);
+    std::vector<size_t> touched;
+    for (size_t vertex = 0; vertex < size; ++vertex) {
+      if (vertex > match[vertex]) {
+        continue;
+      }
+
+      size_t coarse = fine.coarseMap[vertex];
+      for (size_t member : { vertex, match[vertex] }) {
+        result.weights[coarse] += fine.weights[member];
+        for (size_t i = offsets[member]; i < offsets[member + 1]; ++i) {
+          size_t neighbour = fine.coarseMap[columns[i]];
+          if (neighbour == coarse) {
+            continue;
+          }
+          if (accumulated[neighbour] == 0) {
+            touched.emplace_back(neighbour);
+          }
+          accumulated[neighbour] += values[i];
+        }
+
+        if (member == match[vertex]) {
+          break;
+        }
+      }
+
+      std::ranges::sort(touched);
+      for (size_t neighbour : touched) {
+        result.edges.PushBack(neighbour, accumulated[neighbour]);
+        accumulated[neighbour] = 0;
+      }
+      touched.clear();
+      result.edges.EndRow();
+    }
+
+    return result;
+  }
+
+  /**
+   * Places vertices from the heaviest one into the most connected part that still has room.
+   */
+  static std::vector<size_t> CreateInitialPartition(const Level& level, const std::vector<size_t>& limits, std::mt19937_64& rng) {
+    const size_t parts = limits.size();
+    const auto& offsets = level.edges.GetOffsets();
+    const auto& columns = level.edges.GetColumns();
+    const auto& values = level.edges.GetValues();
+    constexpr size_t kUnassigned = std::numeric_limits<size_t>::max();
+
+    std::vector<size_t> order(level.GetSize());
+    std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+    std::ranges::shuffle(order, rng);
+    std::ranges::stable_sort(order, [&](size_t lhs, size_t rhs) {
+      return level.weights[lhs] > level.weights[rhs];
+    });
+
+    std::vector<size_t> partition(level.GetSize(), kUnassigned);
+    std::vector<size_t> partWeights(parts, 0);
+    std::vector<size_t> connectivity(parts, 0);
+    for (size_t vertex : order) {
+      for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+        if (partition[columns[i]] != kUnassigned) {
+          connectivity[partition[columns[i]]] += values[i];
+        }
+      }
+
+      // Most connected part with room, ties go to the least filled one. Overflow goes to the least filled part.
+      size_t best = kUnassigned;
+      for (size_t part = 0; part < parts; ++part) {
+        if (partWeights[part] + level.weights[vertex] > limits[part]) {
+          continue;
+        }
+        if (best == kUnassigned
+          || connectivity[part] > connectivity[best]
+          || (connectivity[part] == connectivity[best] && partWeights[part] * limits[best] < partWeights[best] * limits[part])) {
+          best = part;
+        }
+      }
+      if (best == kUnassigned) {
+        best = 0;
+        for (size_t part = 1; part < parts; ++part) {
+          if (partWeights[part] * limits[best] < partWeights[best] * limits[part]) {
+            best = part;
+          }
+        }
+      }
+
+      partition[vertex] = best;
+      partWeights[best] += level.weights[vertex];
+      std::ranges::fill(connectivity, 0);
+    }
+
+    return partition;
+  }
+
+  /**
+   * Greedy k-way FM refinement. Each pass visits vertices in random order and moves a vertex to the part
+   * it's most connected to if that reduces the cut, or keeps the cut and improves balance, within size limits.
+   * Vertices of overloaded parts may also make cut-increasing moves.
+   */
+  static void Refine(const Level& level, const std::vector<size_t>& limits, size_t passes, std::vector<size_t>& partition, std::mt19937_64& rng) {
+    const size_t parts = limits.size();
+    const auto& offsets = level.edges.GetOffsets();
+    const auto& columns = level.edges.GetColumns();
+    const auto& values = level.edges.GetValues();
+
+    std::vector<size_t> partWeights(parts, 0);
+    for (size_t vertex = 0; vertex < level.GetSize(); ++vertex) {
+      partWeights[partition[vertex]] += level.weights[vertex];
+    }
+
+    std::vector<size_t> order(level.GetSize());
+    std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+    std::vector<size_t> connectivity(parts, 0);
+    std::vector<size_t> touched;
+    for (size_t pass = 0; pass < passes; ++pass) {
+      std::ranges::shuffle(order, rng);
+      bool moved = false;
+
+      for (size_t vertex : order) {
+        const size_t from = partition[vertex];
+        const size_t weight = level.weights[vertex];
+        const bool overloaded = partWeights[from] > limits[from];
+        for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+          size_t part = partition[columns[i]];
+          if (connectivity[part] == 0) {
+            touched.emplace_back(part);
+          }
+          connectivity[part] += values[i];
+        }
+
+        // Interior vertices of balanced parts can't improve anything
+        bool boundary = !touched.empty() && (touched.size() > 1 || touched.front() != from);
+        if (boundary || overloaded) {
+          size_t best = from;
+          int64_t bestGain = overloaded ? std::numeric_limits<int64_t>::min() : 0;
+          auto consider = [&](size_t part) {
+            if (part == from || partWeights[part] + weight > limits[part]) {
+              return;
+            }
+
+            int64_t gain = static_cast<int64_t>(connectivity[part]) - static_cast<int64_t>(connectivity[from]);
+            bool balances = partWeights[part] + weight < partWeights[from];
+            if (gain > bestGain || (gain == bestGain && balances && (best == from || partWeights[part] < partWeights[best]))) {
+              best = part;
+              bestGain = gain;
+            }
+          };
+
+          if (overloaded) {
+            for (size_t part = 0; part < parts; ++part) {
+              consider(part);
+            }
+          }
+          else {
+            for (size_t part : touched) {
+              consider(part);
+            }
+          }
+
+          if (best != from) {
+            partition[vertex] = best;
+            partWeights[from] -= weight;
+            partWeights[best] += weight;
+            moved = true;
+          }
+        }
+
+        for (size_t part : touched) {
+          connectivity[part] = 0;
+        }
+        touched.clear();
+      }
+
+      if (!moved) {
+        break;
+      }
+    }
+  }
+
+  static size_t CalculateCut(const Level& level, const std::vector<size_t>& partition) {
+    const auto& offsets = level.edges.GetOffsets();
+    const auto& columns = level.edges.GetColumns();
+    const auto& values = level.edges.GetValues();
+    size_t result = 0;
+    for (size_t vertex = 0; vertex < level.GetSize(); ++vertex) {
+      for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+        if (partition[vertex] != partition[columns[i]]) {
+          result += values[i];
+        }
+      }
+    }
+
+    return result / 2;
+  }
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 struct TopologyUnit {
   TopologyUnit(float x, float y)
   : m_x(x)
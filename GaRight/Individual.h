@@ -1,25 +1,36 @@
 #pragma once
+#include "EpochEvaluator.h"
+#include "FixedRouterKernels.h"
+#include "GeneticOperators.h"
+#include "Parallel.h"
+#include "ParallelEvaluator.h"
+#include "ParetoSorting.h"
 #include "Topology.h"
 
+#include <span>
+
 struct Individual final {
   explicit Individual(const TopologyInput& input, TopologyRandom& random)
     : m_input(input)
     , m_random(random)
     , m_configuration(TopologyConfiguration::CreateRandom(input, random))
-    , m_fitness(CalculateFitness(input, m_configuration)) {
+    , m_objectives(CalculateObjectives(input, m_configuration))
+    , m_fitness(CalculateFitness(input, m_objectives)) {
   }
 
   explicit Individual(const TopologyInput& input, TopologyRandom& random, const TopologyConfiguration& configuration)
     : m_input(input)
     , m_random(random)
     , m_configuration(configuration)
-    , m_fitness(CalculateFitness(input, configuration)) {
+    , m_objectives(CalculateObjectives(input, m_configuration))
+    , m_fitness(CalculateFitness(input, m_objectives)) {
   }
 
   Individual(const Individual& other)
   : m_input(other.m_input)
   , m_random(other.m_random)
   , m_configuration(other.m_configuration)
+  , m_objectives(other.m_objectives)
   , m_fitness(other.m_fitness) {
   }
 
@@ -27,6 +38,7 @@ struct Individual final {
   : m_input(other.m_input)
   , m_random(other.m_random)
   , m_configuration(std::move(other.m_configuration))
+  , m_objectives(other.m_objectives)
   , m_fitness(other.m_fitness) {
   }
 
@@ -36,6 +48,7 @@ struct Individual final {
     }
     m_random = other.m_random;
     m_configuration = other.m_configuration;
+    m_objectives = other.m_objectives;
     m_fitness = other.m_fitness;
     return *this;
   }
@@ -46,6 +59,7 @@ struct Individual final {
     }
     m_random = other.m_random;
     m_configuration = std::move(other.m_configuration);
+    m_objectives = other.m_objectives;
     m_fitness = other.m_fitness;
     return *this;
   }
@@ -66,6 +80,36 @@ struct Individual final {
     };
   }
 
+  /**
+   * Replaces own configuration with a mutated crossover of parents. Reuses own buffers.
+   * Evaluation is left to the caller, load matrix and fitness stay stale until AssignEvaluation.
+   */
+  void RecombineTables(const Individual& lhs, const Individual& rhs, double probability, CrossoverOperator crossover, MutationOperator mutation, TopologyGenerator::RepairBuffers& buffers, GeneticOperators::Buffers& operatorBuffers) {
+    GeneticOperators::Cross(crossover, m_input, lhs.m_configuration, rhs.m_configuration, m_random, operatorBuffers, m_configuration);
+    GeneticOperators::Mutate(mutation, m_input, probability, m_random, operatorBuffers, m_configuration);
+    TopologyConfiguration::RepairTables(m_input, m_random, buffers, m_configuration);
+    TopologyGenerator::FillSubnetworkTable(m_input.hosts, m_input.routers, m_configuration.membershipTable, m_configuration.subnetworkTable);
+  }
+
+  /**
+   * Stores evaluation made elsewhere. (e.g. by BatchEvaluator)
+   */
+  void AssignEvaluation(std::span<const size_t> loads, const Objectives& objectives) {
+    m_configuration.channelLoadMatrix.Assign(loads);
+    m_objectives = objectives;
+    m_fitness = CalculateFitness(m_input, objectives);
+  }
+
+  /**
+   * Re-scores after the input traffic changed by delta, see TopologyInput::ApplyTrafficDelta. Only loads touched by changed entries are updated.
+   * Per-epoch objectives are evaluated again from the updated epochs.
+   */
+  void Rescore(const TrafficDelta& delta) {
+    m_configuration.ApplyTrafficDelta(m_input, delta);
+    m_objectives = CalculateObjectives(m_input, m_configuration);
+    m_fitness = CalculateFitness(m_input, m_objectives);
+  }
+
   const TopologyConfiguration& GetConfiguration() const {
     return m_configuration;
   }
@@ -74,12 +118,22 @@ struct Individual final {
     return m_fitness;
   }
 
+  /**
+   * Returns fitness components stored at evaluation. Also used as objectives of multi-objective optimisation.
+   */
+  const Objectives& GetObjectives() const {
+    return m_objectives;
+  }
+
   friend std::ostream& operator<<(std::ostream& os, const Individual& obj) {
     os << obj.GetConfiguration();
     os << "Fitness:\n  " << obj.GetFitness() << '\n';
-    os << "Port penalty:\n  " << CalculatePortPenalty(obj.m_input, obj.m_configuration) << '\n';
-    os << "Difference:\n  " << CalculateTrafficDifference(obj.m_input, obj.m_configuration) << '\n';
-    os << "Traffic:\n  " << CalculateTraffic(obj.m_input, obj.m_configuration) << '\n';
+    os << "Port penalty:\n  " << obj.m_objectives.values[1] << '\n';
+    os << "Difference:\n  " << obj.m_objectives.values[0] << '\n';
+    os << "Traffic:\n  " << obj.m_objectives.values[2] << '\n';
+    if (obj.m_input.HasLayout()) {
+      os << "Distance:\n  " << obj.m_objectives.distance << '\n';
+    }
     return os;
   }
 
@@ -118,16 +172,43 @@ struct Individual final {
     return overhead;
   }
 
+  static Objectives CalculateObjectives(const TopologyInput& input, const TopologyConfiguration& conf) {
+    const auto* kernel = FixedRouterKernels::Find(input.routers);
+    size_t trafficDifference = kernel
+      ? kernel->calculateTrafficDifference(input, conf.channelLoadMatrix)
+      : input.routers >= ParallelEvaluator::kMinRouters
+        ? ParallelEvaluator::CalculateTrafficDifference(input, conf.channelLoadMatrix, Parallel::GetThreadsCount())
+        : CalculateTrafficDifference(input, conf);
+    Objectives result { {
+      trafficDifference,
+      CalculatePortPenalty(input, conf),
+      CalculateTraffic(input, conf)
+    }, input.CalculateDistance(conf.membershipTable) };
+
+    if (input.epochs.IsPerEpoch()) {
+      EpochEvaluator::Evaluate(input, conf.membershipTable, conf.routerTypeTable, result);
+    }
+
+    return result;
+  }
+
   static double CalculateFitness(const TopologyInput& input, const TopologyConfiguration& conf) {
-    size_t trafficDifference = CalculateTrafficDifference(input, conf);
-    return 1.0 / (trafficDifference + trafficDifference * CalculatePortPenalty(input, conf));
-    return 1.0 / CalculateTraffic(input, conf);
+    return CalculateFitness(input, CalculateObjectives(input, conf));
+  }
+
+  /**
+   * Fitness of traffic difference, inflated by port penalty. Distance adds to the difference when weighted.
+   */
+  static double CalculateFitness(const TopologyInput& input, const Objectives& objectives) {
+    double cost = objectives.values[0] + input.distanceWeight * objectives.distance;
+    return 1.0 / (cost + cost * objectives.values[1]);
   }
 
   friend void swap(Individual& lhs, Individual& rhs) noexcept {
     using std::swap;
     swap(lhs.m_random, rhs.m_random);
     swap(lhs.m_configuration, rhs.m_configuration);
+    swap(lhs.m_objectives, rhs.m_objectives);
     swap(lhs.m_fitness, rhs.m_fitness);
   }
 
@@ -135,5 +216,6 @@ private:
   const TopologyInput& m_input;
   TopologyRandom& m_random;
   TopologyConfiguration m_configuration;
+  Objectives m_objectives;
   double m_fitness;
 };
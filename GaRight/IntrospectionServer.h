@@ -0,0 +1,355 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "GeneticAlgorithm.h"
+
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/**
+ * State of a running optimisation shared with the introspection server.
+ * The evolution loop only stores atomics and swaps in immutable snapshots, the server only loads them.
+ */
+struct IntrospectionState final {
+  IntrospectionState()
+    : m_generation(0)
+    , m_evaluations(0)
+    , m_evaluationsPerSecond(0.0)
+    , m_bestFitness(0.0)
+    , m_meanFitness(0.0)
+    , m_selectionTime(0)
+    , m_recombinationTime(0)
+    , m_evaluationTime(0)
+    , m_sortingTime(0)
+    , m_mutationProbability(0.0)
+    , m_requestedMutationProbability(std::numeric_limits<double>::quiet_NaN())
+    , m_paused(false)
+    , m_publishedFitness(-1.0) {
+  }
+
+  /**
+   * Called by the evolution loop after each step. Formats the best configuration only when it changes.
+   */
+  void Publish(const GeneticAlgorithm& algorithm) {
+    const auto& timings = algorithm.GetStepTimings();
+    const size_t populationSize = algorithm.GetPopulation().size();
+    uint64_t stepTime = timings.selection + timings.recombination + timings.evaluation + timings.sorting;
+
+    m_generation.store(algorithm.GetGeneration(), std::memory_order_relaxed);
+    m_evaluations.store((algorithm.GetGeneration() + 1) * populationSize, std::memory_order_relaxed);
+    m_evaluationsPerSecond.store(stepTime == 0 ? 0.0 : populationSize * 1e9 / stepTime, std::memory_order_relaxed);
+    m_bestFitness.store(algorithm.GetBest().GetFitness(), std::memory_order_relaxed);
+    m_meanFitness.store(algorithm.GetMeanFitness(), std::memory_order_relaxed);
+    m_selectionTime.store(timings.selection, std::memory_order_relaxed);
+    m_recombinationTime.store(timings.recombination, std::memory_order_relaxed);
+    m_evaluationTime.store(timings.evaluation, std::memory_order_relaxed);
+    m_sortingTime.store(timings.sorting, std::memory_order_relaxed);
+    m_mutationProbability.store(algorithm.GetMutationProbability(), std::memory_order_relaxed);
+
+    if (algorithm.GetBest().GetFitness() != m_publishedFitness) {
+      m_publishedFitness = algorithm.GetBest().GetFitness();
+      std::ostringstream os;
+      os << algorithm.GetBest();
+      m_best.store(std::make_shared<const std::string>(os.str()), std::memory_order_release);
+    }
+  }
+
+  /**
+   * Called by the evolution loop before each step. Blocks while paused, applies requested settings.
+   */
+  void Apply(GeneticAlgorithm& algorithm) {
+    m_paused.wait(true, std::memory_order_acquire);
+
+    double probability = m_requestedMutationProbability.exchange(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+    if (!std::isnan(probability)) {
+      algorithm.SetMutationProbability(probability);
+    }
+  }
+
+  /**
+   * Requests mutation probability change. Applied before the next step.
+   */
+  void SetMutationProbability(double probability) {
+    m_requestedMutationProbability.store(probability, std::memory_order_relaxed);
+  }
+
+  void SetPaused(bool paused) {
+    m_paused.store(paused, std::memory_order_release);
+    m_paused.notify_all();
+  }
+
+  /**
+   * Formats counters as key=value lines.
+   */
+  std::string FormatStatus() const {
+    std::ostringstream os;
+    os << "generation=" << m_generation.load(std::memory_order_relaxed) << '\n';
+    os << "evaluations=" << m_evaluations.load(std::memory_order_relaxed) << '\n';
+    os << "evaluationsPerSecond=" << m_evaluationsPerSecond.load(std::memory_order_relaxed) << '\n';
+    os << "bestFitness=" << m_bestFitness.load(std::memory_order_relaxed) << '\n';
+    os << "meanFitness=" << m_meanFitness.load(std::memory_order_relaxed) << '\n';
+    os << "mutationProbability=" << m_mutationProbability.load(std::memory_order_relaxed) << '\n';
+    os << "paused=" << m_paused.load(std::memory_order_relaxed) << '\n';
+    os << "selectionNs=" << m_selectionTime.load(std::memory_order_relaxed) << '\n';
+    os << "recombinationNs=" << m_recombinationTime.load(std::memory_order_relaxed) << '\n';
+    os << "evaluationNs=" << m_evaluationTime.load(std::memory_order_relaxed) << '\n';
+    os << "sortingNs=" << m_sortingTime.load(std::memory_order_relaxed) << '\n';
+    return os.str();
+  }
+
+  std::shared_ptr<const std::string> GetBest() const {
+    return m_best.load(std::memory_order_acquire);
+  }
+
+private:
+  std::atomic<uint64_t> m_generation;
+  std::atomic<uint64_t> m_evaluations;
+  std::atomic<double> m_evaluationsPerSecond;
+  std::atomic<double> m_bestFitness;
+  std::atomic<double> m_meanFitness;
+  std::atomic<uint64_t> m_selectionTime;
+  std::atomic<uint64_t> m_recombinationTime;
+  std::atomic<uint64_t> m_evaluationTime;
+  std::atomic<uint64_t> m_sortingTime;
+  std::atomic<double> m_mutationProbability;
+  std::atomic<double> m_requestedMutationProbability;
+  std::atomic<bool> m_paused;
+  std::atomic<std::shared_ptr<const std::string>> m_best;
+  /// Fitness of m_best. Only touched by the evolution loop.
+  double m_publishedFitness;
+};
+
+/**
+ * Serves IntrospectionState over a local (AF_UNIX) stream socket from a background thread.
+ * Protocol is line based, every response ends with an empty line:
+ *   status               - counters and phase timings as key=value lines
+ *   best                 - dump of the best configuration
+ *   pause / resume       - holds the evolution loop before its next step
+ *   set mutation <p>     - changes mutation probability from the next step
+ * Clients are served one at a time. Example: socat - UNIX-CONNECT:GaRight.sock
+ */
+struct IntrospectionServer final {
+  explicit IntrospectionServer(const std::filesystem::path& path, IntrospectionState& state)
+    : m_path(path)
+    , m_state(state)
+    , m_listener(kInvalidSocket)
+    , m_wsaStarted(false) {
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+      return;
+    }
+    m_wsaStarted = true;
+#endif
+
+    std::string name = path.string();
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (name.size() >= sizeof(address.sun_path)) {
+      return;
+    }
+    std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+
+    // Socket file of a previous run would fail the bind
+    std::error_code error;
+    std::filesystem::remove(path, error);
+
+    m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listener == kInvalidSocket) {
+      return;
+    }
+    if (bind(m_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(m_listener, 4) != 0) {
+      CloseSocket(m_listener);
+      m_listener = kInvalidSocket;
+      return;
+    }
+
+    m_thread = std::jthread([this](std::stop_token token) {
+      Run(token);
+    });
+  }
+
+  IntrospectionServer(const IntrospectionServer&) = delete;
+  IntrospectionServer& operator=(const IntrospectionServer&) = delete;
+
+  ~IntrospectionServer() {
+    if (m_thread.joinable()) {
+      m_thread.request_stop();
+      m_thread.join();
+    }
+
+    if (m_listener != kInvalidSocket) {
+      CloseSocket(m_listener);
+      std::error_code error;
+      std::filesystem::remove(m_path, error);
+    }
+
+#ifdef _WIN32
+    if (m_wsaStarted) {
+      WSACleanup();
+    }
+#endif
+  }
+
+  bool IsOpen() const {
+    return m_thread.joinable();
+  }
+
+private:
+#ifdef _WIN32
+  using NativeSocket = SOCKET;
+  static constexpr NativeSocket kInvalidSocket = INVALID_SOCKET;
+#else
+  using NativeSocket = int;
+  static constexpr NativeSocket kInvalidSocket = -1;
+#endif
+
+  /// Poll interval, bounds the reaction time to the stop request.
+  static constexpr int kPollTimeout = 100;
+  static constexpr size_t kMaxRequestLength = 4096;
+
+  static void CloseSocket(NativeSocket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+  }
+
+  /**
+   * Returns true when socket is readable.
+   */
+  static bool WaitReadable(NativeSocket socket) {
+    pollfd descriptor {};
+    descriptor.fd = socket;
+    descriptor.events = POLLIN;
+#ifdef _WIN32
+    return WSAPoll(&descriptor, 1, kPollTimeout) > 0;
+#else
+    return poll(&descriptor, 1, kPollTimeout) > 0;
+#endif
+  }
+
+  static bool SendAll(NativeSocket socket, std::string_view data) {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+    while (!data.empty()) {
+      auto sent = send(socket, data.data(), static_cast<int>(data.size()), flags);
+      if (sent <= 0) {
+        return false;
+      }
+      data.remove_prefix(static_cast<size_t>(sent));
+    }
+
+    return true;
+  }
+
+  void Run(std::stop_token token) {
+    while (!token.stop_requested()) {
+      if (!WaitReadable(m_listener)) {
+        continue;
+      }
+
+      NativeSocket client = accept(m_listener, nullptr, nullptr);
+      if (client != kInvalidSocket) {
+        Serve(client, token);
+        CloseSocket(client);
+      }
+    }
+  }
+
+  void Serve(NativeSocket client, std::stop_token token) {
+    std::string buffer;
+    char chunk[512];
+    while (!token.stop_requested()) {
+      if (!WaitReadable(client)) {
+        continue;
+      }
+
+      auto received = recv(client, chunk, static_cast<int>(sizeof(chunk)), 0);
+      if (received <= 0) {
+        return;
+      }
+      buffer.append(chunk, static_cast<size_t>(received));
+
+      size_t end;
+      while ((end = buffer.find('\n')) != std::string::npos) {
+        std::string_view request(buffer.data(), end);
+        if (!request.empty() && request.back() == '\r') {
+          request.remove_suffix(1);
+        }
+        if (!SendAll(client, Handle(request) + '\n')) {
+          return;
+        }
+        buffer.erase(0, end + 1);
+      }
+
+      if (buffer.size() > kMaxRequestLength) {
+        SendAll(client, "error: request is too long\n\n");
+        return;
+      }
+    }
+  }
+
+  std::string Handle(std::string_view request) {
+    if (request == "status") {
+      return m_state.FormatStatus();
+    }
+    if (request == "best") {
+      auto best = m_state.GetBest();
+      return best ? *best : "none\n";
+    }
+    if (request == "pause" || request == "resume") {
+      m_state.SetPaused(request == "pause");
+      return "ok\n";
+    }
+
+    constexpr std::string_view kSetMutation = "set mutation ";
+    if (request.starts_with(kSetMutation)) {
+      request.remove_prefix(kSetMutation.size());
+      double probability = 0.0;
+      auto [last, error] = std::from_chars(request.data(), request.data() + request.size(), probability);
+      if (error != std::errc() || last != request.data() + request.size() || probability < 0.0 || probability > 1.0) {
+        return "error: expected probability in [0, 1]\n";
+      }
+
+      m_state.SetMutationProbability(probability);
+      return "ok\n";
+    }
+
+    return "error: unknown command\n";
+  }
+
+  std::filesystem::path m_path;
+  IntrospectionState& m_state;
+  NativeSocket m_listener;
+  /// WSACleanup must balance a successful WSAStartup only. Always false outside Windows.
+  bool m_wsaStarted;
+  std::jthread m_thread;
+};
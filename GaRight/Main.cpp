@@ -1,83 +1,35 @@
+#include "FlowLogReader.h"
+#include "GeneticAlgorithm.h"
 #include "Individual.h"
+#include "IntrospectionServer.h"
+#include "Nsga2.h"
+#include "Parallel.h"
+#include "PopulationSeeding.h"
 #include "PortDistributor.h"
+#include "ProgressTrace.h"
+#include "SimulatedAnnealing.h"
 #include "Topology.h"
 #include "TopologyInputGenerator.h"
+#include "TrafficDelta.h"
 
 #include <cassert>
+#include <filesystem>
+#include <optional>
 #include <ostream>
 #include <Windows.h>
 #include <ConsoleLib/Console.h>
 
-struct GreaterFitnessComparator {
-  bool operator()(const Individual& lhs, const Individual& rhs) const {
-    return lhs.GetFitness() > rhs.GetFitness();
-  }
-};
-
-std::vector<double> CalculateCumulativeProbabilities(const std::vector<Individual>& population) {
-  double fitnessSum = std::accumulate(population.begin(), population.end(), 0.0f, [](double old, const Individual& v) {
-    return old + v.GetFitness();
-  });
-
-  std::vector<double> result;
-  result.reserve(population.size());
-  double accumulated = 0.0f;
-
-  for (const auto& v : population) {
-    accumulated += v.GetFitness() / fitnessSum;
-    result.emplace_back(accumulated);
-  }
-
-  return result;
-}
-
-std::vector<Individual> RouletteSelect(const std::vector<Individual>& population, TopologyRandom& random) {
-  std::vector<double> probabilities = CalculateCumulativeProbabilities(population);
-  std::vector<Individual> result;
-  result.reserve(population.size());
-
-  for (size_t i = 0; i < population.size(); ++i) {
-    double rand = random.dist(random.rng);
-    for (size_t j = 0; j < probabilities.size(); ++j) {
-      if (rand <= probabilities[j]) {
-        result.emplace_back(population[j]);
-        break;
-      }
-    }
-  }
-
-  return result;
-}
-
-std::vector<Individual> DoSelection(const TopologyInput& input, std::vector<Individual> pool, double probability, TopologyRandom& random) {
-  std::vector<Individual> result;
-  result.reserve(pool.size());
-  std::ranges::shuffle(pool, random.rng);
-
-  for (size_t i = 0; i < pool.size(); i += 2) {
-    Individual i1 = pool[i];
-    Individual i2 = pool[i + 1];
-    result.emplace_back(Individual::Mutate(
-      input,
-      probability,
-      Individual::Cross(input, i1, i2, random),
-      random));
-    result.emplace_back(Individual::Mutate(
-      input,
-      probability,
-      Individual::Cross(input, i1, i2, random),
-      random));
-  }
-
-  return result;
-}
-
 int WINAPI wWinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPWSTR, _In_ int) {
   Console::GetInstance()->RedirectStdHandles();
 
   // Input pre-generation
 
-  const size_t hostsCount = 12;
+  // Traffic of real hosts when set, random traffic otherwise. Each line is "source,destination,bytes"
+  const std::filesystem::path flowLogPath;
+  FlowTable flowTable;
+  const bool useFlowLog = !flowLogPath.empty() && FlowLogReader::Read(flowLogPath, {}, flowTable);
+
+  const size_t hostsCount = useFlowLog ? flowTable.hosts.size() : 12;
   const size_t routersCount = 3;
   const size_t minPorts = 2;
 
@@ -93,38 +45,178 @@ int WINAPI wWinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPWSTR, _In_ int) {
     hostsCount,
     routersCount,
     PortDistributor::RandomDistribution(routersCount, hostsCount, minOffset, random.rng, random.dist),
-    TopologyInputGenerator::CreateTrafficMatrix(hostsCount, { 0.5, 4500, 500 }, random.rng, random.dist),
-    TopologyInputGenerator::CreateBandwidthMatrix(routersCount, { 50000, 30000 }, random.rng)
+    useFlowLog ? flowTable.CreateTrafficMatrix() : TopologyInputGenerator::CreateTrafficMatrix(hostsCount, { 0.5, 4500, 500 }, random.rng(), Parallel::GetThreadsCount()),
+    TopologyInputGenerator::CreateBandwidthMatrix(routersCount, { 50000, 30000 }, random.rng())
   };
+
+  // Robust optimisation across traffic epochs (day, night, peak). Traffic matrix becomes their mean
+  const size_t epochsCount = 1;
+  std::vector<Matrix<size_t>> epochs;
+  if (epochsCount > 1 && !useFlowLog) {
+    for (size_t i = 0; i < epochsCount; ++i) {
+      epochs.emplace_back(TopologyInputGenerator::CreateTrafficMatrix(hostsCount, { 0.5, 4500, 500 }, random.rng(), Parallel::GetThreadsCount()));
+    }
+    input.SetTrafficEpochs(epochs, EpochAggregation::WORST);
+  }
+
+  // Layout and nearest candidate routers of each host. Distance adds to the traffic difference and becomes an objective of NSGA-II
+  const bool useLayout = false;
+  const size_t candidatesCount = 2;
+  const double distanceWeight = 10.0;
+  if (useLayout) {
+    const uint64_t layoutSeed = random.rng();
+    input.hostUnits = TopologyInputGenerator::CreateHostUnits(input.trafficMatrix, { 100.0f, 100.0f }, layoutSeed);
+    input.routerUnits = TopologyInputGenerator::CreateRouterUnits(input.bandwidthMatrix, { 100.0f, 100.0f }, layoutSeed);
+    input.candidates = CandidateTable::Create(input.hostUnits, input.routerUnits, candidatesCount);
+    input.distanceWeight = distanceWeight;
+  }
   std::cout << input << '\n';
 
   // Population initialization
 
   const size_t populationSize = 10;
-  size_t iteration = 0;
+  const bool multiObjective = false;
+  // Part of the population starts from a partition of the traffic graph
+  const SeedingOptions seeding { 0.3, 0.05 };
+  // Share of evaluations re-checked by the reference evaluator
+  const double verificationRate = 0.0;
+  // Operator variants chosen per offspring by their recent improvement per microsecond. Off until GaBenchmark shows ga-adaptive no worse than ga
+  const bool adaptiveOperators = false;
+
+  if (multiObjective) {
+    // Pareto front of (difference, port penalty, traffic), distance with a layout
+    Nsga2 nsga2(input, random, { populationSize, 1.0 / populationSize, seeding });
+
+    while (true) {
+      std::cout << '[' << nsga2.GetGeneration() << "]: Pareto front (difference, port penalty, traffic" << (useLayout ? ", distance)\n" : ")\n");
+      for (const auto& individual : nsga2.GetFront()) {
+        auto objectives = individual.GetObjectives();
+        std::cout << "  " << objectives.values[0] << ", " << objectives.values[1] << ", " << objectives.values[2];
+        if (useLayout) {
+          std::cout << ", " << objectives.distance;
+        }
+        std::cout << '\n';
+      }
+
+      Console::GetInstance()->Pause();
+      nsga2.Step();
+    }
+  }
+
+  // Single-trajectory alternative to the genetic algorithm. Chains score the mean traffic matrix, not each epoch
+  const bool simulatedAnnealing = false;
+  if (simulatedAnnealing) {
+    SimulatedAnnealing annealing(input, { Parallel::GetThreadsCount(), 2000000, 20000, CoolingSchedule::GEOMETRIC });
+    auto start = std::chrono::steady_clock::now();
+    double bestFitness = 0.0;
+
+    do {
+      if (annealing.GetBestFitness() > bestFitness) {
+        bestFitness = annealing.GetBestFitness();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << '[' << annealing.GetSteps() << "]: fitness " << bestFitness << ", temperature " << annealing.GetTemperature()
+          << ", moves per second " << (seconds > 0.0 ? annealing.GetSteps() * Parallel::GetThreadsCount() / seconds : 0.0) << '\n';
+      }
+    } while (annealing.Step());
 
-  std::vector<Individual> population;
-  population.reserve(populationSize);
-  for (size_t i = 0; i < populationSize; ++i) {
-    population.emplace_back(input, random);
+    std::cout << "End of annealing. Accepted moves: " << annealing.GetAcceptedMoves() << '\n';
+    std::cout << Individual(input, random, annealing.CreateBestConfiguration()) << '\n';
+    while (true) {
+      Console::GetInstance()->Pause();
+    }
+  }
+
+  // Binary progress trace. Decode with TraceDecoder
+  const bool writeTrace = false;
+  std::optional<ProgressTraceWriter> trace;
+  if (writeTrace) {
+    trace.emplace("GaRight.trace");
   }
-  std::ranges::sort(population, GreaterFitnessComparator());
-  std::cout << '[' << iteration << "]:\n" << population[0] << '\n';
+
+  GeneticAlgorithm algorithm(input, random, { populationSize, 1.0 / populationSize, seeding, verificationRate, adaptiveOperators });
+  std::cout << '[' << algorithm.GetGeneration() << "]:\n" << algorithm.GetBest() << '\n';
+  double bestFitness = algorithm.GetBest().GetFitness();
+
+  // Local socket for monitoring and tuning. Replaces interactive pauses
+  const bool listenSocket = false;
+  IntrospectionState introspection;
+  std::optional<IntrospectionServer> server;
+  if (listenSocket) {
+    introspection.Publish(algorithm);
+    server.emplace("GaRight.sock", introspection);
+  }
+
+  // Simulated traffic drift every driftInterval generations. The population is re-scored and keeps evolving
+  const size_t driftInterval = 0;
+  const size_t driftEntries = 4;
 
   // Selection
 
-  while (population[0].GetFitness() != std::numeric_limits<double>::infinity()) {
-    // Roulette select
-    std::vector<Individual> pool = RouletteSelect(population, random);
-    population = DoSelection(input, pool, 1.0 / populationSize, random);
-    std::ranges::sort(population, GreaterFitnessComparator());
+  while (algorithm.GetBest().GetFitness() != std::numeric_limits<double>::infinity()) {
+    if (server) {
+      introspection.Apply(algorithm);
+    }
+    if (driftInterval != 0 && algorithm.GetGeneration() % driftInterval == driftInterval - 1) {
+      // With epochs, entries of random epochs drift and their mean follows
+      Matrix<size_t> drifted = input.trafficMatrix;
+      std::vector<Matrix<size_t>> driftedEpochs = epochs;
+      for (size_t i = 0; i < driftEntries; ++i) {
+        Matrix<size_t>& target = driftedEpochs.empty() ? drifted : driftedEpochs[random.rng() % driftedEpochs.size()];
+        target.At(random.rng() % hostsCount, random.rng() % hostsCount) = random.rng() % 5000;
+      }
 
-    ++iteration;
-    std::cout << '[' << iteration << "]:\n" << population[0] << '\n';
+      TrafficDelta delta = driftedEpochs.empty()
+        ? TrafficDelta::Create(input.trafficMatrix, drifted)
+        : TrafficDelta::Create(input.trafficMatrix, TrafficEpochs::CreateMeanMatrix(driftedEpochs), input.epochs, TrafficEpochs::Create(driftedEpochs, input.epochs.aggregation, input.epochs.percentile));
+      epochs = std::move(driftedEpochs);
+      input.ApplyTrafficDelta(delta);
+      algorithm.Rescore(delta);
+      bestFitness = algorithm.GetBest().GetFitness();
+    }
+    algorithm.Step();
+    if (server) {
+      introspection.Publish(algorithm);
+    }
 
-    Console::GetInstance()->Pause();
+    const Individual& best = algorithm.GetBest();
+    if (trace) {
+      const auto& objectives = best.GetObjectives();
+      trace->Write({
+        algorithm.GetGeneration(),
+        trace->GetTimestamp(),
+        best.GetFitness(),
+        algorithm.GetMeanFitness(),
+        objectives.values[0],
+        objectives.values[1],
+        objectives.values[2]
+      });
+    }
+
+    // Dump configuration only when it improves
+    if (best.GetFitness() > bestFitness) {
+      bestFitness = best.GetFitness();
+      std::cout << '[' << algorithm.GetGeneration() << "]:\n" << best;
+      std::cout << "Allocations:\n  " << algorithm.GetStepAllocations() << "\n";
+      if (adaptiveOperators) {
+        std::cout << "Operator shares:\n";
+        for (size_t i = 0; i < static_cast<size_t>(CrossoverOperator::COUNT); ++i) {
+          std::cout << "  " << GeneticOperators::GetName(static_cast<CrossoverOperator>(i)) << ": " << algorithm.GetOperatorShare(static_cast<CrossoverOperator>(i)) << '\n';
+        }
+        for (size_t i = 0; i < static_cast<size_t>(MutationOperator::COUNT); ++i) {
+          std::cout << "  " << GeneticOperators::GetName(static_cast<MutationOperator>(i)) << ": " << algorithm.GetOperatorShare(static_cast<MutationOperator>(i)) << '\n';
+        }
+      }
+      std::cout << '\n';
+
+      if (!server) {
+        Console::GetInstance()->Pause();
+      }
+    }
   }
 
+  // Flush the rest of the trace
+  trace.reset();
+
   std::cout << "End of selection. Press any key to exit.\n";
   while (true) {
     Console::GetInstance()->Pause();
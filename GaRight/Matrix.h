@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <ostream>
+#include <span>
 #include <vector>
 
 template <typename T>
@@ -23,6 +25,11 @@ struct Matrix {
     , m_data(width* height, value) {
   }
 
+  Matrix(const Matrix&) = default;
+  Matrix(Matrix&&) noexcept = default;
+  Matrix& operator=(const Matrix&) = default;
+  Matrix& operator=(Matrix&&) noexcept = default;
+
   virtual ~Matrix() = default;
 
   T& operator()(size_t row, size_t col) {
@@ -51,6 +58,18 @@ struct Matrix {
     return os;
   }
 
+  void Fill(const T& value) {
+    std::ranges::fill(m_data, value);
+  }
+
+  /**
+   * Overwrites all elements with values stored in the same layout.
+   */
+  void Assign(std::span<const T> values) {
+    assert(values.size() == m_data.size());
+    std::ranges::copy(values, m_data.begin());
+  }
+
   size_t GetWidth() const {
     return m_width;
   }
@@ -89,3 +108,106 @@ struct SymmetricalMatrix final : Matrix<T> {
     Matrix<T>::At(col, row) = value;
   }
 };
+
+/**
+ * Row-compressed sparse matrix. Rows are appended in order, so it can be filled from a stream
+ * without materialising the dense matrix.
+ */
+template <typename T>
+struct SparseMatrix final {
+  SparseMatrix()
+    : m_width(0)
+    , m_offsets { 0 } {
+  }
+
+  explicit SparseMatrix(size_t width)
+    : m_width(width)
+    , m_offsets { 0 } {
+  }
+
+  /**
+   * Appends a non-zero element to the last row.
+   */
+  void PushBack(size_t col, const T& value) {
+    assert(col < m_width);
+    assert(m_columns.size() == m_offsets.back() || m_columns.back() < col);
+    m_columns.emplace_back(col);
+    m_values.emplace_back(value);
+  }
+
+  /**
+   * Finishes the last row and starts a new one.
+   */
+  void EndRow() {
+    m_offsets.emplace_back(m_columns.size());
+  }
+
+  /**
+   * Appends all rows of other matrix.
+   */
+  void Append(const SparseMatrix& other) {
+    assert(m_width == other.m_width);
+    size_t base = m_columns.size();
+    m_columns.insert(m_columns.end(), other.m_columns.begin(), other.m_columns.end());
+    m_values.insert(m_values.end(), other.m_values.begin(), other.m_values.end());
+    for (size_t i = 1; i < other.m_offsets.size(); ++i) {
+      m_offsets.emplace_back(base + other.m_offsets[i]);
+    }
+  }
+
+  T At(size_t row, size_t col) const {
+    assert(row < GetHeight() && col < m_width);
+    auto first = m_columns.begin() + m_offsets[row];
+    auto last = m_columns.begin() + m_offsets[row + 1];
+    auto it = std::lower_bound(first, last, col);
+    if (it == last || *it != col) {
+      return T();
+    }
+
+    return m_values[it - m_columns.begin()];
+  }
+
+  /**
+   * Converts to dense matrix with the same element indexing.
+   */
+  Matrix<T> ToDense() const {
+    Matrix<T> result(GetHeight(), m_width);
+    for (size_t row = 0; row < GetHeight(); ++row) {
+      for (size_t i = m_offsets[row]; i < m_offsets[row + 1]; ++i) {
+        result.At(row, m_columns[i]) = m_values[i];
+      }
+    }
+
+    return result;
+  }
+
+  size_t GetWidth() const {
+    return m_width;
+  }
+
+  size_t GetHeight() const {
+    return m_offsets.size() - 1;
+  }
+
+  size_t GetNonZeroCount() const {
+    return m_values.size();
+  }
+
+  const std::vector<size_t>& GetOffsets() const {
+    return m_offsets;
+  }
+
+  const std::vector<size_t>& GetColumns() const {
+    return m_columns;
+  }
+
+  const std::vector<T>& GetValues() const {
+    return m_values;
+  }
+
+private:
+  size_t m_width;
+  std::vector<size_t> m_offsets;
+  std::vector<size_t> m_columns;
+  std::vector<T> m_values;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Individual.h"
+#include "ParetoSorting.h"
+#include "PopulationSeeding.h"
+#include "Topology.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+/**
+ * Multi-objective optimiser (NSGA-II) over traffic difference, port penalty and total traffic, plus host-gateway distance with a layout.
+ * Keeps the population ranked by non-dominated fronts and crowding distance.
+ */
+struct Nsga2 final {
+  struct Options final {
+    size_t populationSize;
+    double mutationProbability;
+    SeedingOptions seeding;
+  };
+
+  explicit Nsga2(const TopologyInput& input, TopologyRandom& random, const Options& options)
+    : m_input(input)
+    , m_random(random)
+    , m_options(options)
+    , m_generation(0) {
+    Reduce(PopulationSeeding::CreatePopulation(input, random, options.populationSize, options.seeding));
+  }
+
+  /**
+   * Produces offspring, merges them with the population and keeps the best half.
+   */
+  void Step() {
+    std::vector<Individual> combined = m_population;
+    combined.reserve(m_population.size() * 2);
+
+    while (combined.size() < m_population.size() * 2) {
+      const Individual& lhs = m_population[Tournament()];
+      const Individual& rhs = m_population[Tournament()];
+      combined.emplace_back(Individual::Mutate(
+        m_input,
+        m_options.mutationProbability,
+        Individual::Cross(m_input, lhs, rhs, m_random),
+        m_random));
+    }
+
+    Reduce(std::move(combined));
+    ++m_generation;
+  }
+
+  /**
+   * Returns the first non-dominated front.
+   */
+  std::vector<Individual> GetFront() const {
+    std::vector<Individual> result;
+    for (size_t i = 0; i < m_population.size() && m_ranks[i] == 0; ++i) {
+      result.emplace_back(m_population[i]);
+    }
+
+    return result;
+  }
+
+  const std::vector<Individual>& GetPopulation() const {
+    return m_population;
+  }
+
+  size_t GetGeneration() const {
+    return m_generation;
+  }
+
+private:
+  /**
+   * Binary tournament with crowded comparison. Lower rank wins, then larger crowding distance.
+   */
+  size_t Tournament() {
+    size_t lhs = m_random.rng() % m_population.size();
+    size_t rhs = m_random.rng() % m_population.size();
+    if (m_ranks[lhs] != m_ranks[rhs]) {
+      return m_ranks[lhs] < m_ranks[rhs] ? lhs : rhs;
+    }
+
+    return m_crowding[lhs] >= m_crowding[rhs] ? lhs : rhs;
+  }
+
+  /**
+   * Keeps the best populationSize individuals front by front.
+   * The last partially fitting front is truncated by crowding distance.
+   * Population ends up sorted by rank.
+   */
+  void Reduce(std::vector<Individual> candidates) {
+    std::vector<Objectives> objectives;
+    objectives.reserve(candidates.size());
+    for (const auto& individual : candidates) {
+      objectives.emplace_back(individual.GetObjectives());
+    }
+
+    std::vector<Individual> population;
+    population.reserve(m_options.populationSize);
+    m_ranks.clear();
+    m_crowding.clear();
+
+    const size_t count = Objectives::GetCount(m_input.HasLayout());
+    auto fronts = ParetoSorting::Sort(objectives, count);
+    for (size_t rank = 0; rank < fronts.size() && population.size() < m_options.populationSize; ++rank) {
+      auto& front = fronts[rank];
+      auto distance = ParetoSorting::CalculateCrowdingDistance(objectives, front, count);
+
+      std::vector<size_t> order(front.size());
+      std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+      std::ranges::sort(order, [&](size_t lhs, size_t rhs) {
+        return distance[lhs] > distance[rhs];
+      });
+
+      for (size_t i = 0; i < order.size() && population.size() < m_options.populationSize; ++i) {
+        population.emplace_back(std::move(candidates[front[order[i]]]));
+        m_ranks.emplace_back(rank);
+        m_crowding.emplace_back(distance[order[i]]);
+      }
+    }
+
+    m_population = std::move(population);
+  }
+
+  const TopologyInput& m_input;
+  TopologyRandom& m_random;
+  Options m_options;
+  size_t m_generation;
+  std::vector<Individual> m_population;
+  std::vector<size_t> m_ranks;
+  std::vector<double> m_crowding;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+/**
+ * Discounted UCB over operator variants. The value of an arm is its recent improvement per microsecond relative to the best arm,
+ * so effort shifts to whatever improves fastest on the current instance, and shifts again when that changes.
+ * Selection counts are updated on Select, so offspring of one generation are spread over arms before any reward comes in.
+ */
+struct OperatorBandit final {
+  struct Options final {
+    /// Weight of the exploration term.
+    double exploration = 0.3;
+    /// Multiplier applied to all statistics every generation. Lower forgets faster.
+    double discount = 0.9;
+  };
+
+  explicit OperatorBandit(size_t arms, const Options& options)
+    : m_options(options)
+    , m_counts(arms, 0.0)
+    , m_rewards(arms, 0.0)
+    , m_times(arms, 0.0) {
+    assert(arms != 0);
+  }
+
+  size_t GetArmsCount() const {
+    return m_counts.size();
+  }
+
+  /**
+   * Returns the arm with the highest upper confidence bound. Unplayed arms go first.
+   */
+  size_t Select() {
+    const size_t arms = m_counts.size();
+    double total = 0.0;
+    double bestRate = 0.0;
+    for (size_t arm = 0; arm < arms; ++arm) {
+      if (m_counts[arm] == 0.0) {
+        m_counts[arm] += 1.0;
+        return arm;
+      }
+      total += m_counts[arm];
+      bestRate = std::max(bestRate, GetRate(arm));
+    }
+
+    size_t selected = 0;
+    double selectedScore = -1.0;
+    const double logTotal = std::log(std::max(total, 1.0));
+    for (size_t arm = 0; arm < arms; ++arm) {
+      double value = bestRate > 0.0 ? GetRate(arm) / bestRate : 0.0;
+      double score = value + m_options.exploration * std::sqrt(logTotal / m_counts[arm]);
+      if (score > selectedScore) {
+        selected = arm;
+        selectedScore = score;
+      }
+    }
+
+    m_counts[selected] += 1.0;
+    return selected;
+  }
+
+  /**
+   * Records the outcome of a selected arm: non-negative improvement and the CPU time it took.
+   */
+  void Reward(size_t arm, double improvement, double microseconds) {
+    m_rewards[arm] += improvement;
+    m_times[arm] += microseconds;
+  }
+
+  /**
+   * Fades statistics of past generations.
+   */
+  void Discount() {
+    for (size_t arm = 0; arm < m_counts.size(); ++arm) {
+      m_counts[arm] *= m_options.discount;
+      m_rewards[arm] *= m_options.discount;
+      m_times[arm] *= m_options.discount;
+    }
+  }
+
+  /**
+   * Returns the recent improvement per microsecond of the arm.
+   */
+  double GetRate(size_t arm) const {
+    return m_times[arm] > 0.0 ? m_rewards[arm] / m_times[arm] : 0.0;
+  }
+
+  /**
+   * Returns the share of recent selections that went to the arm.
+   */
+  double GetShare(size_t arm) const {
+    double total = 0.0;
+    for (double count : m_counts) {
+      total += count;
+    }
+    return total > 0.0 ? m_counts[arm] / total : 0.0;
+  }
+
+private:
+  Options m_options;
+  std::vector<double> m_counts;
+  std::vector<double> m_rewards;
+  std::vector<double> m_times;
+};
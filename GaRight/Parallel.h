@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * Contains helpers for splitting work over threads.
+ */
+struct Parallel final {
+  /**
+   * Returns the number of hardware threads, at least 1.
+   */
+  static size_t GetThreadsCount() {
+    return std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+  }
+
+  /**
+   * Splits [0, count) into contiguous blocks and calls function(begin, end, block) for each of them.
+   * The calling thread processes the first block. Returns when all blocks are processed.
+   */
+  template <typename Function>
+  static void ForBlocks(size_t count, size_t threads, Function&& function) {
+    threads = std::clamp(threads, static_cast<size_t>(1), std::max(count, static_cast<size_t>(1)));
+    if (threads == 1) {
+      function(static_cast<size_t>(0), count, static_cast<size_t>(0));
+      return;
+    }
+
+    std::vector<std::jthread> workers;
+    workers.reserve(threads - 1);
+    for (size_t block = 1; block < threads; ++block) {
+      workers.emplace_back([&function, count, threads, block] {
+        function(BlockBegin(count, threads, block), BlockBegin(count, threads, block + 1), block);
+      });
+    }
+
+    function(BlockBegin(count, threads, 0), BlockBegin(count, threads, 1), static_cast<size_t>(0));
+  }
+
+  /**
+   * Returns the first index of the block. Blocks differ in size by at most one.
+   */
+  static size_t BlockBegin(size_t count, size_t blocks, size_t block) {
+    return count / blocks * block + std::min(block, count % blocks);
+  }
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "EvaluationBatch.h"
+#include "Matrix.h"
+#include "Parallel.h"
+#include "TopologyGenerator.h"
+#include "TopologyInput.h"
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+/**
+ * Splits evaluation of large configurations over threads.
+ * Every thread sums traffic of its own block of traffic matrix columns into a private partial flow matrix,
+ * partial matrices are then reduced by element blocks. Inner loops need no locks or atomics.
+ * Partial matrices take threads x router^2 per configuration, so beyond kMaxPartialFlows every thread owns a slice
+ * of destination routers instead and writes flow(*, r2) of its columns in place.
+ */
+struct ParallelEvaluator final {
+  /// Hosts count from which flows are accumulated in parallel.
+  static constexpr size_t kMinHosts = 2048;
+  /// Routers count from which traffic difference is calculated in parallel.
+  static constexpr size_t kMinRouters = 512;
+  /// Elements of all partial flow matrices, 32 MiB. Router slices are used above it.
+  static constexpr size_t kMaxPartialFlows = static_cast<size_t>(1) << 22;
+
+  /**
+   * Fills load matrix of a single configuration. Same result as TopologyGenerator::FillLoadMatrix.
+   */
+  static void FillLoadMatrix(const TopologyInput& input, std::span<const size_t> membership, std::span<const RouterType> routerTypes, SymmetricalMatrix<size_t>& loadMatrix, size_t threads) {
+    const size_t routers = input.routers;
+    threads = std::clamp(threads, static_cast<size_t>(1), std::max(input.hosts, static_cast<size_t>(1)));
+
+    std::vector<size_t> flows(routers * routers);
+    if (threads * flows.size() <= kMaxPartialFlows) {
+      std::vector<size_t> partialFlows(threads * flows.size(), 0);
+      Parallel::ForBlocks(input.hosts, threads, [&](size_t begin, size_t end, size_t block) {
+        AccumulateColumns(input, membership.data(), begin, end, partialFlows.data() + block * flows.size());
+      });
+      Reduce(partialFlows, threads, flows, threads);
+    }
+    else {
+      std::vector<size_t> slices(threads + 1);
+      SliceRouters(membership.data(), input.hosts, routers, threads, slices.data());
+      Parallel::ForBlocks(threads, threads, [&](size_t, size_t, size_t block) {
+        AccumulateSlice(input, membership.data(), slices[block], slices[block + 1], flows.data());
+      });
+    }
+
+    std::vector<size_t> flowSums(routers, 0);
+    for (size_t to = 0; to < routers; ++to) {
+      for (size_t from = 0; from < routers; ++from) {
+        flowSums[from] += flows[from + routers * to];
+      }
+    }
+
+    if (loadMatrix.GetWidth() != routers) {
+      loadMatrix = SymmetricalMatrix<size_t>(routers);
+    }
+
+    // Switch sends flow(r1, r2) to r2, hub sends all flow of r1
+    auto output = [&](size_t from, size_t to) {
+      return routerTypes[from] == RouterType::SWITCH ? flows[from + routers * to] : flowSums[from];
+    };
+    for (size_t row = 0; row < routers; ++row) {
+      loadMatrix.At(row, row) = 0;
+      for (size_t col = row + 1; col < routers; ++col) {
+        loadMatrix.Set(row, col, output(row, col) + output(col, row));
+      }
+    }
+  }
+
+  /**
+   * Calculates sum|Ti-Bi| over router pairs with per-thread partial sums.
+   */
+  static size_t CalculateTrafficDifference(const TopologyInput& input, const SymmetricalMatrix<size_t>& loadMatrix, size_t threads) {
+    const size_t routers = input.routers;
+    threads = std::clamp(threads, static_cast<size_t>(1), std::max(routers, static_cast<size_t>(1)));
+
+    std::vector<size_t> partialSums(threads, 0);
+    Parallel::ForBlocks(routers, threads, [&](size_t begin, size_t end, size_t block) {
+      size_t accumulated = 0;
+      for (size_t row = begin; row < end; ++row) {
+        for (size_t col = row + 1; col < routers; ++col) {
+          size_t traffic = loadMatrix.At(row, col) * 2;
+          size_t bandwidth = input.bandwidthMatrix.At(row, col);
+          accumulated += std::max(traffic, bandwidth) - std::min(traffic, bandwidth);
+        }
+      }
+      partialSums[block] = accumulated;
+    });
+
+    size_t result = 0;
+    for (size_t sum : partialSums) {
+      result += sum;
+    }
+
+    return result;
+  }
+
+  /**
+   * Fills flows of all batch configurations. Same result as the sequential accumulation of BatchEvaluator.
+   */
+  static void AccumulateFlows(const TopologyInput& input, EvaluationBatch& batch, size_t threads) {
+    const size_t hosts = input.hosts;
+    const size_t flowsSize = input.routers * input.routers;
+    threads = std::clamp(threads, static_cast<size_t>(1), std::max(hosts, static_cast<size_t>(1)));
+
+    if (threads * batch.flows.size() > kMaxPartialFlows) {
+      batch.routerSlices.resize(batch.count * (threads + 1));
+      for (size_t i = 0; i < batch.count; ++i) {
+        SliceRouters(batch.membership.data() + i * hosts, hosts, input.routers, threads, batch.routerSlices.data() + i * (threads + 1));
+      }
+      Parallel::ForBlocks(threads, threads, [&](size_t, size_t, size_t block) {
+        for (size_t i = 0; i < batch.count; ++i) {
+          const size_t* slices = batch.routerSlices.data() + i * (threads + 1);
+          AccumulateSlice(input, batch.membership.data() + i * hosts, slices[block], slices[block + 1], batch.flows.data() + i * flowsSize);
+        }
+      });
+      return;
+    }
+
+    batch.partialFlows.resize(threads * batch.flows.size());
+    std::ranges::fill(batch.partialFlows, 0);
+    Parallel::ForBlocks(hosts, threads, [&](size_t begin, size_t end, size_t block) {
+      size_t* partial = batch.partialFlows.data() + block * batch.flows.size();
+      for (size_t i = 0; i < batch.count; ++i) {
+        AccumulateColumns(input, batch.membership.data() + i * hosts, begin, end, partial + i * flowsSize);
+      }
+    });
+
+    Reduce(batch.partialFlows, threads, batch.flows, threads);
+  }
+
+private:
+  /**
+   * flow(membership[host], membership[col]) += traffic(host, col) for columns [begin, end).
+   */
+  static void AccumulateColumns(const TopologyInput& input, const size_t* membership, size_t begin, size_t end, size_t* flows) {
+    const size_t hosts = input.hosts;
+    const size_t* traffic = input.trafficMatrix.GetData().data();
+    for (size_t col = begin; col < end; ++col) {
+      const size_t* column = traffic + hosts * col;
+      size_t* flowColumn = flows + input.routers * membership[col];
+      for (size_t host = 0; host < hosts; ++host) {
+        flowColumn[membership[host]] += column[host];
+      }
+    }
+  }
+
+  /**
+   * Splits routers into slices of consecutive routers with about the same hosts count. Slice b is [slices[b], slices[b + 1]).
+   */
+  static void SliceRouters(const size_t* membership, size_t hosts, size_t routers, size_t threads, size_t* slices) {
+    std::vector<size_t> hostsCount(routers, 0);
+    for (size_t host = 0; host < hosts; ++host) {
+      ++hostsCount[membership[host]];
+    }
+
+    size_t router = 0;
+    size_t covered = 0;
+    for (size_t block = 0; block < threads; ++block) {
+      for (; router < routers && covered < Parallel::BlockBegin(hosts, threads, block); ++router) {
+        covered += hostsCount[router];
+      }
+      slices[block] = router;
+    }
+    slices[threads] = routers;
+  }
+
+  /**
+   * Fills flow(*, r2) for destination routers r2 in [first, last). Touches only the columns of that slice.
+   */
+  static void AccumulateSlice(const TopologyInput& input, const size_t* membership, size_t first, size_t last, size_t* flows) {
+    const size_t hosts = input.hosts;
+    const size_t routers = input.routers;
+    const size_t* traffic = input.trafficMatrix.GetData().data();
+    std::fill(flows + routers * first, flows + routers * last, 0);
+    for (size_t col = 0; col < hosts; ++col) {
+      if (membership[col] < first || membership[col] >= last) {
+        continue;
+      }
+      const size_t* column = traffic + hosts * col;
+      size_t* flowColumn = flows + routers * membership[col];
+      for (size_t host = 0; host < hosts; ++host) {
+        flowColumn[membership[host]] += column[host];
+      }
+    }
+  }
+
+  /**
+   * result = sum of partial[0..parts), each of result.size() elements. Split by element blocks.
+   */
+  static void Reduce(const std::vector<size_t>& partial, size_t parts, std::vector<size_t>& result, size_t threads) {
+    const size_t size = result.size();
+    Parallel::ForBlocks(size, threads, [&](size_t begin, size_t end, size_t) {
+      std::copy(partial.begin() + begin, partial.begin() + end, result.begin() + begin);
+      for (size_t part = 1; part < parts; ++part) {
+        const size_t* source = partial.data() + part * size;
+        for (size_t i = begin; i < end; ++i) {
+          result[i] += source[i];
+        }
+      }
+    });
+  }
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+/// Objectives of a configuration. All of them are minimised.
+struct Objectives final {
+  static constexpr size_t kCount = 3;
+
+  /// Traffic difference, port penalty, total traffic.
+  std::array<size_t, kCount> values;
+  /// Total host-gateway distance. 0 without a layout.
+  double distance = 0.0;
+
+  /**
+   * Returns the number of objectives to compare. Distance is the last one and only counts with a layout.
+   */
+  static size_t GetCount(bool hasLayout) {
+    return hasLayout ? kCount + 1 : kCount;
+  }
+
+  double Get(size_t objective) const {
+    return objective < kCount ? static_cast<double>(values[objective]) : distance;
+  }
+
+  /**
+   * Returns true if this is not worse in each of the first count objectives and better in at least one.
+   */
+  bool Dominates(const Objectives& other, size_t count) const {
+    bool better = false;
+    for (size_t i = 0; i < count; ++i) {
+      if (Get(i) > other.Get(i)) {
+        return false;
+      }
+      better |= Get(i) < other.Get(i);
+    }
+
+    return better;
+  }
+};
+
+/**
+ * Contains methods for non-dominated sorting and crowding distance.
+ */
+struct ParetoSorting final {
+  /**
+   * Splits solutions into non-dominated fronts. (Efficient non-dominated sort with binary search, ENS-BS)
+   * Solutions are visited in lexicographic order, so a solution can only be dominated by already placed ones.
+   * Being dominated by some front implies being dominated by every previous front, so the front is found by binary search.
+   * Takes O(M * N * log N) comparisons in the best case instead of O(M * N^2).
+   * Only the first count objectives are compared, see Objectives::GetCount.
+   */
+  static std::vector<std::vector<size_t>> Sort(const std::vector<Objectives>& objectives, size_t count) {
+    std::vector<size_t> order(objectives.size());
+    std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+    std::ranges::sort(order, [&](size_t lhs, size_t rhs) {
+      for (size_t i = 0; i < count; ++i) {
+        if (objectives[lhs].Get(i) != objectives[rhs].Get(i)) {
+          return objectives[lhs].Get(i) < objectives[rhs].Get(i);
+        }
+      }
+      return false;
+    });
+
+    std::vector<std::vector<size_t>> fronts;
+    for (size_t solution : order) {
+      size_t first = 0;
+      size_t last = fronts.size();
+      while (first < last) {
+        size_t middle = (first + last) / 2;
+        if (IsDominated(objectives, fronts[middle], solution, count)) {
+          first = middle + 1;
+        }
+        else {
+          last = middle;
+        }
+      }
+
+      if (first == fronts.size()) {
+        fronts.emplace_back();
+      }
+      fronts[first].emplace_back(solution);
+    }
+
+    return fronts;
+  }
+
+  /**
+   * Calculates crowding distance of front members. Boundary solutions of every non-constant objective get infinity.
+   * Result is indexed the same way as front.
+   */
+  static std::vector<double> CalculateCrowdingDistance(const std::vector<Objectives>& objectives, const std::vector<size_t>& front, size_t count) {
+    std::vector<double> result(front.size(), 0.0);
+    if (front.size() <= 2) {
+      std::ranges::fill(result, std::numeric_limits<double>::infinity());
+      return result;
+    }
+
+    std::vector<size_t> order(front.size());
+    for (size_t objective = 0; objective < count; ++objective) {
+      std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+      std::ranges::sort(order, [&](size_t lhs, size_t rhs) {
+        return objectives[front[lhs]].Get(objective) < objectives[front[rhs]].Get(objective);
+      });
+
+      double min = objectives[front[order.front()]].Get(objective);
+      double max = objectives[front[order.back()]].Get(objective);
+      // Constant objective doesn't tell members apart, its arbitrary boundaries must not be favoured
+      if (max == min) {
+        continue;
+      }
+      result[order.front()] = std::numeric_limits<double>::infinity();
+      result[order.back()] = std::numeric_limits<double>::infinity();
+
+      for (size_t i = 1; i + 1 < order.size(); ++i) {
+        double next = objectives[front[order[i + 1]]].Get(objective);
+        double previous = objectives[front[order[i - 1]]].Get(objective);
+        result[order[i]] += (next - previous) / (max - min);
+      }
+    }
+
+    return result;
+  }
+
+private:
+  /**
+   * Checks the front from the most recently added member, which is the most likely dominator.
+   */
+  static bool IsDominated(const std::vector<Objectives>& objectives, const std::vector<size_t>& front, size_t solution, size_t count) {
+    for (auto it = front.rbegin(); it != front.rend(); ++it) {
+      if (objectives[*it].Dominates(objectives[solution], count)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "GraphPartitioner.h"
+#include "Individual.h"
+#include "Topology.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/// Initial population settings.
+struct SeedingOptions final {
+  /// Share of individuals built from a partition of the traffic graph. The rest are random.
+  double share = 0.0;
+  /// Probability of moving each host of a seeded individual to a random router.
+  double perturbation = 0.05;
+  GraphPartitioner::Options partitioner;
+};
+
+/**
+ * Creates initial populations.
+ */
+struct PopulationSeeding final {
+  /**
+   * The traffic graph is partitioned once and projected onto candidate routers. The first seeded individual keeps the partition as is,
+   * the other ones are its randomised variations.
+   */
+  static std::vector<Individual> CreatePopulation(const TopologyInput& input, TopologyRandom& random, size_t populationSize, const SeedingOptions& options) {
+    std::vector<Individual> population;
+    population.reserve(populationSize);
+
+    size_t seeded = std::min(populationSize, static_cast<size_t>(std::llround(populationSize * options.share)));
+    if (seeded != 0) {
+      std::vector<size_t> partition = GraphPartitioner::Partition(input.trafficMatrix, input.portsCount, options.partitioner, random.rng);
+      if (!input.candidates.IsEmpty()) {
+        ProjectOnCandidates(input, partition);
+      }
+      for (size_t i = 0; i < seeded; ++i) {
+        double perturbation = i == 0 ? 0.0 : options.perturbation;
+        population.emplace_back(input, random, TopologyConfiguration::CreateSeeded(input, random, partition, perturbation));
+      }
+    }
+
+    while (population.size() < populationSize) {
+      population.emplace_back(input, random);
+    }
+
+    return population;
+  }
+
+private:
+  /**
+   * Parts are routers, but the partitioner doesn't know candidates. Each host outside of its candidates goes to the candidate
+   * with free ports it exchanges the most traffic with, to the one with the most traffic if all of them are full.
+   * Hosts of candidate parts stay, so the rest of the partition is kept.
+   */
+  static void ProjectOnCandidates(const TopologyInput& input, std::vector<size_t>& partition) {
+    constexpr size_t kUnassigned = std::numeric_limits<size_t>::max();
+    std::vector<size_t> hostsCount(input.routers, 0);
+    std::vector<size_t> projected;
+    for (size_t host = 0; host < input.hosts; ++host) {
+      auto candidates = input.candidates.Get(host);
+      if (std::ranges::find(candidates, partition[host]) == candidates.end()) {
+        projected.emplace_back(host);
+        partition[host] = kUnassigned;
+      }
+      else {
+        ++hostsCount[partition[host]];
+      }
+    }
+    if (projected.empty()) {
+      return;
+    }
+
+    const SparseMatrix<size_t> graph = GraphPartitioner::CreateTrafficGraph(input.trafficMatrix);
+    std::vector<size_t> affinity(input.routers);
+    for (size_t host : projected) {
+      std::ranges::fill(affinity, 0);
+      for (size_t i = graph.GetOffsets()[host]; i < graph.GetOffsets()[host + 1]; ++i) {
+        size_t router = partition[graph.GetColumns()[i]];
+        if (router != kUnassigned) {
+          affinity[router] += graph.GetValues()[i];
+        }
+      }
+
+      size_t best = kUnassigned;
+      bool bestFree = false;
+      for (size_t router : input.candidates.Get(host)) {
+        bool free = hostsCount[router] < input.portsCount[router];
+        if (best == kUnassigned || (free && !bestFree) || (free == bestFree && affinity[router] > affinity[best])) {
+          best = router;
+          bestFree = free;
+        }
+      }
+      partition[host] = best;
+      ++hostsCount[best];
+    }
+  }
+};
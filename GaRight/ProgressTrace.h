@@ -0,0 +1,179 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Progress of a single generation.
+struct ProgressRecord final {
+  uint64_t generation;
+  /// Nanoseconds since the start of the trace.
+  uint64_t timestamp;
+  double bestFitness;
+  double meanFitness;
+  /// Fitness components of the best individual.
+  uint64_t trafficDifference;
+  uint64_t portPenalty;
+  uint64_t traffic;
+};
+
+static_assert(std::is_trivially_copyable_v<ProgressRecord>);
+
+/// Header of a trace file. Followed by ProgressRecord array in native byte order.
+struct ProgressTraceHeader final {
+  static constexpr char kMagic[8] = { 'G', 'A', 'T', 'R', 'A', 'C', 'E', '1' };
+
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  /// System clock time of the start in nanoseconds since epoch.
+  int64_t startTime;
+};
+
+static_assert(std::is_trivially_copyable_v<ProgressTraceHeader>);
+
+/**
+ * Writes progress records to a binary file from a background thread.
+ * Write only appends to an in-memory buffer; the buffer is flushed when it fills up, every flush interval
+ * and when the writer is destroyed, so a run that is killed loses at most the last interval.
+ */
+struct ProgressTraceWriter final {
+  explicit ProgressTraceWriter(const std::filesystem::path& path, size_t bufferRecords = 4096, std::chrono::milliseconds flushInterval = std::chrono::seconds(1))
+    : m_file(path, std::ios::binary)
+    , m_bufferRecords(bufferRecords)
+    , m_flushInterval(flushInterval)
+    , m_start(std::chrono::steady_clock::now())
+    , m_stop(false) {
+    if (!m_file) {
+      return;
+    }
+
+    ProgressTraceHeader header {};
+    std::memcpy(header.magic, ProgressTraceHeader::kMagic, sizeof(header.magic));
+    header.version = 1;
+    header.recordSize = sizeof(ProgressRecord);
+    header.startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_front.reserve(m_bufferRecords);
+    m_back.reserve(m_bufferRecords);
+    m_thread = std::jthread([this] {
+      Run();
+    });
+  }
+
+  ProgressTraceWriter(const ProgressTraceWriter&) = delete;
+  ProgressTraceWriter& operator=(const ProgressTraceWriter&) = delete;
+
+  ~ProgressTraceWriter() {
+    if (!m_thread.joinable()) {
+      return;
+    }
+
+    {
+      std::lock_guard lock(m_mutex);
+      m_stop = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+  }
+
+  bool IsOpen() const {
+    return m_thread.joinable();
+  }
+
+  /**
+   * Returns nanoseconds since the start of the trace.
+   */
+  uint64_t GetTimestamp() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+  }
+
+  void Write(const ProgressRecord& record) {
+    if (!IsOpen()) {
+      return;
+    }
+
+    bool full = false;
+    {
+      std::lock_guard lock(m_mutex);
+      m_front.emplace_back(record);
+      full = m_front.size() >= m_bufferRecords;
+    }
+
+    if (full) {
+      m_condition.notify_one();
+    }
+  }
+
+private:
+  void Run() {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+      m_condition.wait_for(lock, m_flushInterval, [this] {
+        return m_stop || m_front.size() >= m_bufferRecords;
+      });
+
+      // Swap buffers and write without holding the lock
+      std::swap(m_front, m_back);
+      bool stop = m_stop;
+      lock.unlock();
+      if (!m_back.empty()) {
+        m_file.write(reinterpret_cast<const char*>(m_back.data()), static_cast<std::streamsize>(m_back.size() * sizeof(ProgressRecord)));
+        m_back.clear();
+        m_file.flush();
+      }
+      lock.lock();
+
+      if (stop && m_front.empty()) {
+        break;
+      }
+    }
+  }
+
+  std::ofstream m_file;
+  size_t m_bufferRecords;
+  std::chrono::milliseconds m_flushInterval;
+  std::chrono::steady_clock::time_point m_start;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::vector<ProgressRecord> m_front;
+  std::vector<ProgressRecord> m_back;
+  bool m_stop;
+  std::jthread m_thread;
+};
+
+/**
+ * Contains methods for reading trace files.
+ */
+struct ProgressTraceReader final {
+  /**
+   * Reads the header and passes every record to visitor. Returns false if the file is not a trace.
+   */
+  static bool Read(std::istream& stream, ProgressTraceHeader& header, const std::function<void(const ProgressRecord&)>& visitor) {
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))
+      || std::memcmp(header.magic, ProgressTraceHeader::kMagic, sizeof(header.magic)) != 0
+      || header.recordSize != sizeof(ProgressRecord)) {
+      return false;
+    }
+
+    std::vector<ProgressRecord> records(4096);
+    while (stream) {
+      stream.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(ProgressRecord)));
+      size_t count = static_cast<size_t>(stream.gcount()) / sizeof(ProgressRecord);
+      for (size_t i = 0; i < count; ++i) {
+        visitor(records[i]);
+      }
+    }
+
+    return true;
+  }
+};
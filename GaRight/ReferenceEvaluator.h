@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Individual.h"
+#include "ParetoSorting.h"
+#include "Topology.h"
+#include "TopologyGenerator.h"
+#include "TopologyInput.h"
+
+#include <vector>
+
+/**
+ * Straightforward evaluation used to verify the fast paths. Builds the subnetwork table and the load matrix
+ * by walking subnetworks (TopologyGenerator::CreateLoadMatrix) and evaluates every traffic epoch separately.
+ * Doesn't use any stored derived data of the configuration.
+ */
+struct ReferenceEvaluator final {
+  struct Evaluation final {
+    SymmetricalMatrix<size_t> loadMatrix;
+    Objectives objectives;
+    double fitness;
+  };
+
+  static Evaluation Evaluate(const TopologyInput& input, const std::vector<size_t>& membershipTable, const std::vector<RouterType>& routerTypeTable) {
+    TopologyConfiguration conf {
+      membershipTable,
+      TopologyGenerator::CreateSubnetworkTable(input.hosts, input.routers, membershipTable),
+      routerTypeTable,
+      {}
+    };
+    conf.channelLoadMatrix = TopologyGenerator::CreateLoadMatrix(input.hosts, input.routers, { input.trafficMatrix, conf.subnetworkTable, conf.routerTypeTable });
+
+    Objectives objectives { {
+      Individual::CalculateTrafficDifference(input, conf),
+      Individual::CalculatePortPenalty(input, conf),
+      Individual::CalculateTraffic(input, conf)
+    }, input.CalculateDistance(conf.membershipTable) };
+
+    if (input.epochs.IsPerEpoch()) {
+      std::vector<size_t> differences;
+      std::vector<size_t> traffics;
+      TopologyConfiguration epochConf = conf;
+      for (size_t epoch = 0; epoch < input.epochs.count; ++epoch) {
+        Matrix<size_t> traffic = input.epochs.CreateMatrix(epoch, input.hosts);
+        epochConf.channelLoadMatrix = TopologyGenerator::CreateLoadMatrix(input.hosts, input.routers, { traffic, conf.subnetworkTable, conf.routerTypeTable });
+        differences.emplace_back(Individual::CalculateTrafficDifference(input, epochConf));
+        traffics.emplace_back(Individual::CalculateTraffic(input, epochConf));
+      }
+      objectives.values[0] = input.epochs.Aggregate(differences);
+      if (input.epochs.IsTrafficPerEpoch()) {
+        objectives.values[2] = input.epochs.Aggregate(traffics);
+      }
+    }
+
+    double fitness = Individual::CalculateFitness(input, objectives);
+    return Evaluation { std::move(conf.channelLoadMatrix), objectives, fitness };
+  }
+};
@@ -0,0 +1,590 @@
+#pragma once
+
+#include "Individual.h"
+#include "Parallel.h"
+#include "Topology.h"
+#include "TopologyGenerator.h"
+#include "TopologyInput.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <vector>
+
+enum class CoolingSchedule {
+  /// T0 * r^(k/n)
+  GEOMETRIC,
+  /// T0 * (1 - (1 - r) * k/n)
+  LINEAR,
+  /// T0 / ln(e + c * k). Slow by design, the final temperature isn't reached
+  LOGARITHMIC
+};
+
+/**
+ * Simulated annealing over host reassignments, gateway swaps of two hosts and router type flips with the fitness of Individual.
+ * Every chain keeps inter-router flows and per-host traffic to each router, so a move is scored in O(routers)
+ * by touching only the channels of the two routers involved. An accepted host move updates affinities in O(hosts).
+ * A swap keeps port usage, so it crosses the port penalty that single moves of a fully occupied configuration face.
+ * It's scored as two chained host moves, the first one is undone in O(hosts) if the swap is rejected.
+ * Chains run in parallel. At every exchange only the chains with the highest energy restart from the best state found so far,
+ * the others keep their own trajectories, so the chains stay diverse.
+ * Traffic epochs aren't supported: chains score the mean traffic matrix, not each epoch.
+ */
+struct SimulatedAnnealing final {
+  struct Options final {
+    /// Independent chains, each on its own thread if hardware allows.
+    size_t chains = 1;
+    /// Moves per chain over the whole run.
+    size_t steps = 1000000;
+    /// Moves per chain between best state exchanges.
+    size_t exchangeInterval = 10000;
+    CoolingSchedule schedule = CoolingSchedule::GEOMETRIC;
+    /// Probability to accept an average uphill move at the start. Sets the initial temperature.
+    double initialAcceptance = 0.5;
+    /// Final temperature relative to the initial one. Not used by the logarithmic schedule.
+    double finalTemperature = 1e-4;
+    /// Moves scale c of the logarithmic schedule.
+    double logarithmicRate = 1.0;
+    /// Share of moves that flip a router type instead of moving a host.
+    double typeFlipShare = 0.1;
+    /// Share of moves that swap gateways of two hosts instead of moving one.
+    double swapShare = 0.5;
+    /// Chains with the highest energy restarted from the best state at every exchange.
+    size_t replacedChains = 1;
+    uint64_t seed = 0;
+  };
+
+  explicit SimulatedAnnealing(const TopologyInput& input, const Options& options)
+    : m_input(input)
+    , m_options(options)
+    , m_step(0)
+    , m_initialTemperature(1.0)
+    , m_bestEnergy(std::numeric_limits<double>::infinity()) {
+    assert(input.routers != 0 && options.chains != 0);
+    const size_t hosts = input.hosts;
+    const size_t* traffic = input.trafficMatrix.GetData().data();
+    m_rowTotals.assign(hosts, 0);
+    for (size_t col = 0; col < hosts; ++col) {
+      for (size_t row = 0; row < hosts; ++row) {
+        m_rowTotals[row] += traffic[hosts * col + row];
+      }
+    }
+
+    std::mt19937_64 seeds(options.seed);
+    m_chains.resize(options.chains);
+    for (auto& chain : m_chains) {
+      chain.rng.seed(seeds());
+      chain.Reset(input, TopologyGenerator::CreateMembershipTable(hosts, input.routers, input.portsCount, input.candidates, chain.rng), TopologyGenerator::CreateRouterTypeTable(input.routers, chain.rng));
+    }
+    m_initialTemperature = CalibrateTemperature();
+    UpdateBest();
+  }
+
+  /**
+   * Runs every chain for the next exchange interval, then restarts the worst ones from the best state.
+   * Returns false once all steps are done.
+   */
+  bool Step() {
+    if (m_step >= m_options.steps) {
+      return false;
+    }
+
+    const size_t steps = std::min(m_options.exchangeInterval, m_options.steps - m_step);
+    Parallel::ForBlocks(m_chains.size(), std::min(m_chains.size(), Parallel::GetThreadsCount()), [&](size_t begin, size_t end, size_t) {
+      for (size_t i = begin; i < end; ++i) {
+        Run(m_chains[i], steps);
+      }
+    });
+    m_step += steps;
+
+    UpdateBest();
+    ReplaceWorstChains();
+    return m_step < m_options.steps;
+  }
+
+  /**
+   * Returns the best configuration found so far, evaluated.
+   */
+  TopologyConfiguration CreateBestConfiguration() const {
+    TopologyConfiguration result { m_bestMembership, {}, m_bestTypes, SymmetricalMatrix<size_t>(m_input.routers) };
+    result.Update(m_input);
+    return result;
+  }
+
+  double GetBestFitness() const {
+    return 1.0 / m_bestEnergy;
+  }
+
+  /**
+   * Returns moves made by each chain so far.
+   */
+  size_t GetSteps() const {
+    return m_step;
+  }
+
+  /**
+   * Returns accepted moves of all chains.
+   */
+  size_t GetAcceptedMoves() const {
+    size_t result = 0;
+    for (const auto& chain : m_chains) {
+      result += chain.accepted;
+    }
+    return result;
+  }
+
+  double GetTemperature() const {
+    return GetTemperature(m_step);
+  }
+
+  size_t GetChainsCount() const {
+    return m_chains.size();
+  }
+
+  /**
+   * Returns the current configuration of the chain with its incrementally kept loads, not evaluated again. Used for verification.
+   */
+  TopologyConfiguration CreateChainConfiguration(size_t index) const {
+    const Chain& chain = m_chains[index];
+    TopologyConfiguration result { chain.membership, {}, chain.types, SymmetricalMatrix<size_t>(m_input.routers) };
+    TopologyGenerator::FillSubnetworkTable(m_input.hosts, m_input.routers, result.membershipTable, result.subnetworkTable);
+    result.channelLoadMatrix.Assign(chain.loads);
+    return result;
+  }
+
+  /**
+   * Returns objectives of the chain's current configuration as kept incrementally. Used for verification.
+   */
+  Objectives GetChainObjectives(size_t index) const {
+    const Chain& chain = m_chains[index];
+    const size_t routers = m_input.routers;
+    size_t traffic = 0;
+    for (size_t row = 0; row < routers; ++row) {
+      for (size_t col = row + 1; col < routers; ++col) {
+        traffic += 2 * chain.loads[row + routers * col];
+      }
+    }
+    return Objectives { { chain.difference, chain.penalty, traffic }, chain.distance };
+  }
+
+  double GetChainFitness(size_t index) const {
+    return 1.0 / m_chains[index].energy;
+  }
+
+private:
+  /// Chain state. Flows and loads are [from + routers * to], affinities [host * routers + router].
+  struct Chain final {
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> dist;
+    std::vector<size_t> membership;
+    std::vector<RouterType> types;
+    std::vector<size_t> hostsCount;
+    /// Traffic from hosts of one router to hosts of another.
+    std::vector<size_t> flows;
+    /// Traffic from hosts of each router to all hosts.
+    std::vector<size_t> flowSums;
+    std::vector<size_t> loads;
+    /// Traffic from each host to hosts of each router.
+    std::vector<size_t> affinityOut;
+    /// Traffic from hosts of each router to each host.
+    std::vector<size_t> affinityIn;
+    size_t difference = 0;
+    size_t penalty = 0;
+    double distance = 0.0;
+    double energy = 0.0;
+    /// Channels changed by the last scored move and their new loads.
+    std::vector<size_t> pendingChannels;
+    std::vector<size_t> pendingLoads;
+    size_t accepted = 0;
+    std::vector<size_t> bestMembership;
+    std::vector<RouterType> bestTypes;
+    double bestEnergy = std::numeric_limits<double>::infinity();
+
+    size_t GetOutput(size_t routers, size_t from, size_t to) const {
+      return types[from] == RouterType::SWITCH ? flows[from + routers * to] : flowSums[from];
+    }
+
+    /**
+     * Rebuilds all derived state of the configuration. O(hosts^2).
+     */
+    void Reset(const TopologyInput& input, const std::vector<size_t>& newMembership, const std::vector<RouterType>& newTypes) {
+      const size_t hosts = input.hosts;
+      const size_t routers = input.routers;
+      const size_t* traffic = input.trafficMatrix.GetData().data();
+      membership = newMembership;
+      types = newTypes;
+
+      hostsCount.assign(routers, 0);
+      for (size_t router : membership) {
+        ++hostsCount[router];
+      }
+
+      flows.assign(routers * routers, 0);
+      affinityOut.assign(hosts * routers, 0);
+      affinityIn.assign(hosts * routers, 0);
+      for (size_t col = 0; col < hosts; ++col) {
+        const size_t* column = traffic + hosts * col;
+        for (size_t row = 0; row < hosts; ++row) {
+          flows[membership[row] + routers * membership[col]] += column[row];
+          affinityOut[row * routers + membership[col]] += column[row];
+          affinityIn[col * routers + membership[row]] += column[row];
+        }
+      }
+
+      flowSums.assign(routers, 0);
+      for (size_t to = 0; to < routers; ++to) {
+        for (size_t from = 0; from < routers; ++from) {
+          flowSums[from] += flows[from + routers * to];
+        }
+      }
+
+      loads.assign(routers * routers, 0);
+      difference = 0;
+      for (size_t row = 0; row < routers; ++row) {
+        for (size_t col = row + 1; col < routers; ++col) {
+          size_t load = GetOutput(routers, row, col) + GetOutput(routers, col, row);
+          loads[row + routers * col] = load;
+          loads[col + routers * row] = load;
+          difference += GetDifference(input, row, col, load);
+        }
+      }
+
+      penalty = 0;
+      for (size_t router = 0; router < routers; ++router) {
+        penalty += GetOverhead(input, router, hostsCount[router]);
+      }
+      distance = input.CalculateDistance(membership);
+      energy = GetEnergy(input, difference, penalty, distance);
+
+      pendingChannels.reserve(2 * routers);
+      pendingLoads.reserve(2 * routers);
+      if (energy < bestEnergy || bestMembership.empty()) {
+        bestEnergy = energy;
+        bestMembership = membership;
+        bestTypes = types;
+      }
+    }
+
+    /**
+     * Scores moving host to router. New loads are kept until Apply. O(routers).
+     */
+    double ScoreMove(const TopologyInput& input, const std::vector<size_t>& rowTotals, size_t host, size_t to) {
+      const size_t routers = input.routers;
+      const size_t from = membership[host];
+      const size_t self = input.trafficMatrix.At(host, host);
+      const size_t* out = affinityOut.data() + host * routers;
+      const size_t* in = affinityIn.data() + host * routers;
+
+      // Traffic between the host and other hosts of router r, excluding traffic to itself
+      auto outgoing = [&](size_t r) {
+        return static_cast<int64_t>(out[r] - (r == from ? self : 0));
+      };
+      auto incoming = [&](size_t r) {
+        return static_cast<int64_t>(in[r] - (r == from ? self : 0));
+      };
+      // Output of x to y once the host leaves from for to
+      auto output = [&](size_t x, size_t y) -> size_t {
+        if (types[x] == RouterType::HUB) {
+          return flowSums[x] - (x == from ? rowTotals[host] : 0) + (x == to ? rowTotals[host] : 0);
+        }
+        int64_t delta = 0;
+        delta -= x == from ? outgoing(y) : 0;
+        delta -= y == from ? incoming(x) : 0;
+        delta -= x == from && y == from ? static_cast<int64_t>(self) : 0;
+        delta += x == to ? outgoing(y) : 0;
+        delta += y == to ? incoming(x) : 0;
+        delta += x == to && y == to ? static_cast<int64_t>(self) : 0;
+        return static_cast<size_t>(static_cast<int64_t>(flows[x + routers * y]) + delta);
+      };
+
+      pendingChannels.clear();
+      pendingLoads.clear();
+      int64_t differenceDelta = 0;
+      for (size_t y = 0; y < routers; ++y) {
+        for (size_t x : { from, to }) {
+          if (y == x || (x == to && y == from)) {
+            continue;
+          }
+          size_t load = output(x, y) + output(y, x);
+          differenceDelta += static_cast<int64_t>(GetDifference(input, x, y, load)) - static_cast<int64_t>(GetDifference(input, x, y, loads[x + routers * y]));
+          pendingChannels.emplace_back(x + routers * y);
+          pendingLoads.emplace_back(load);
+        }
+      }
+
+      size_t newPenalty = penalty
+        - GetOverhead(input, from, hostsCount[from]) + GetOverhead(input, from, hostsCount[from] - 1)
+        - GetOverhead(input, to, hostsCount[to]) + GetOverhead(input, to, hostsCount[to] + 1);
+      double newDistance = input.HasLayout() ? distance - input.GetDistance(host, from) + input.GetDistance(host, to) : 0.0;
+      return GetEnergy(input, static_cast<size_t>(static_cast<int64_t>(difference) + differenceDelta), newPenalty, newDistance);
+    }
+
+    /**
+     * Moves host to router. Flows and loads of the two routers' channels change, affinities of every host to them as well. O(hosts + routers).
+     */
+    void ApplyMove(const TopologyInput& input, const std::vector<size_t>& rowTotals, size_t host, size_t to, double newEnergy) {
+      const size_t hosts = input.hosts;
+      const size_t routers = input.routers;
+      const size_t from = membership[host];
+      const size_t self = input.trafficMatrix.At(host, host);
+      const size_t* traffic = input.trafficMatrix.GetData().data();
+      size_t* out = affinityOut.data() + host * routers;
+      size_t* in = affinityIn.data() + host * routers;
+
+      ApplyPendingLoads(input, newEnergy);
+      penalty = penalty
+        - GetOverhead(input, from, hostsCount[from]) + GetOverhead(input, from, hostsCount[from] - 1)
+        - GetOverhead(input, to, hostsCount[to]) + GetOverhead(input, to, hostsCount[to] + 1);
+      if (input.HasLayout()) {
+        distance += input.GetDistance(host, to) - input.GetDistance(host, from);
+      }
+
+      for (size_t r = 0; r < routers; ++r) {
+        size_t outgoing = out[r] - (r == from ? self : 0);
+        size_t incoming = in[r] - (r == from ? self : 0);
+        flows[from + routers * r] -= outgoing;
+        flows[to + routers * r] += outgoing;
+        flows[r + routers * from] -= incoming;
+        flows[r + routers * to] += incoming;
+      }
+      flows[from + routers * from] -= self;
+      flows[to + routers * to] += self;
+      flowSums[from] -= rowTotals[host];
+      flowSums[to] += rowTotals[host];
+
+      const size_t* column = traffic + hosts * host;
+      for (size_t peer = 0; peer < hosts; ++peer) {
+        size_t toHost = column[peer];
+        size_t fromHost = traffic[hosts * peer + host];
+        affinityOut[peer * routers + from] -= toHost;
+        affinityOut[peer * routers + to] += toHost;
+        affinityIn[peer * routers + from] -= fromHost;
+        affinityIn[peer * routers + to] += fromHost;
+      }
+
+      --hostsCount[from];
+      ++hostsCount[to];
+      membership[host] = to;
+    }
+
+    /**
+     * Scores changing type of router. O(routers).
+     */
+    double ScoreFlip(const TopologyInput& input, size_t router, RouterType type) {
+      const size_t routers = input.routers;
+      pendingChannels.clear();
+      pendingLoads.clear();
+      int64_t differenceDelta = 0;
+      for (size_t y = 0; y < routers; ++y) {
+        if (y == router) {
+          continue;
+        }
+        size_t output = type == RouterType::SWITCH ? flows[router + routers * y] : flowSums[router];
+        size_t load = output + GetOutput(routers, y, router);
+        differenceDelta += static_cast<int64_t>(GetDifference(input, router, y, load)) - static_cast<int64_t>(GetDifference(input, router, y, loads[router + routers * y]));
+        pendingChannels.emplace_back(router + routers * y);
+        pendingLoads.emplace_back(load);
+      }
+
+      return GetEnergy(input, static_cast<size_t>(static_cast<int64_t>(difference) + differenceDelta), penalty, distance);
+    }
+
+    void ApplyFlip(const TopologyInput& input, size_t router, RouterType type, double newEnergy) {
+      ApplyPendingLoads(input, newEnergy);
+      types[router] = type;
+    }
+
+    void ApplyPendingLoads(const TopologyInput& input, double newEnergy) {
+      const size_t routers = input.routers;
+      for (size_t i = 0; i < pendingChannels.size(); ++i) {
+        size_t x = pendingChannels[i] % routers;
+        size_t y = pendingChannels[i] / routers;
+        difference = difference - GetDifference(input, x, y, loads[x + routers * y]) + GetDifference(input, x, y, pendingLoads[i]);
+        loads[x + routers * y] = pendingLoads[i];
+        loads[y + routers * x] = pendingLoads[i];
+      }
+      energy = newEnergy;
+    }
+
+    static size_t GetDifference(const TopologyInput& input, size_t x, size_t y, size_t load) {
+      size_t traffic = load * 2;
+      size_t bandwidth = input.bandwidthMatrix.At(x, y);
+      return std::max(traffic, bandwidth) - std::min(traffic, bandwidth);
+    }
+
+    static size_t GetOverhead(const TopologyInput& input, size_t router, size_t hosts) {
+      return hosts > input.portsCount[router] ? hosts - input.portsCount[router] : 0;
+    }
+
+    /**
+     * Reciprocal of Individual::CalculateFitness.
+     */
+    static double GetEnergy(const TopologyInput& input, size_t difference, size_t penalty, double distance) {
+      double cost = difference + input.distanceWeight * distance;
+      return cost + cost * penalty;
+    }
+  };
+
+  double GetTemperature(size_t step) const {
+    const double progress = static_cast<double>(step) / std::max(m_options.steps, static_cast<size_t>(1));
+    const double ratio = m_options.finalTemperature;
+    switch (m_options.schedule) {
+      case CoolingSchedule::LINEAR:
+        return m_initialTemperature * (1.0 - (1.0 - ratio) * progress);
+      case CoolingSchedule::LOGARITHMIC:
+        return m_initialTemperature / std::log(std::numbers::e + m_options.logarithmicRate * step);
+      default:
+        return m_initialTemperature * std::pow(ratio, progress);
+    }
+  }
+
+  /**
+   * Proposes a random move of the chain and accepts it by the Metropolis criterion.
+   */
+  void Run(Chain& chain, size_t steps) {
+    const TopologyInput& input = m_input;
+    for (size_t i = 0; i < steps; ++i) {
+      const double temperature = GetTemperature(m_step + i);
+      const double kind = chain.dist(chain.rng);
+      if (input.hosts == 0 || input.routers == 1 || kind < m_options.typeFlipShare) {
+        constexpr size_t types = static_cast<size_t>(RouterType::COUNT);
+        size_t router = chain.rng() % input.routers;
+        auto type = static_cast<RouterType>((static_cast<size_t>(chain.types[router]) + 1 + chain.rng() % (types - 1)) % types);
+        double energy = chain.ScoreFlip(input, router, type);
+        if (Accept(chain, energy - chain.energy, temperature)) {
+          chain.ApplyFlip(input, router, type, energy);
+        }
+      }
+      else if (kind < m_options.typeFlipShare + m_options.swapShare) {
+        size_t first = chain.rng() % input.hosts;
+        size_t second = chain.rng() % input.hosts;
+        size_t firstRouter = chain.membership[first];
+        size_t secondRouter = chain.membership[second];
+        if (firstRouter == secondRouter || !IsCandidate(first, secondRouter) || !IsCandidate(second, firstRouter)) {
+          continue;
+        }
+
+        const double energy = chain.energy;
+        chain.ApplyMove(input, m_rowTotals, first, secondRouter, chain.ScoreMove(input, m_rowTotals, first, secondRouter));
+        double swapped = chain.ScoreMove(input, m_rowTotals, second, firstRouter);
+        if (Accept(chain, swapped - energy, temperature)) {
+          chain.ApplyMove(input, m_rowTotals, second, firstRouter, swapped);
+        }
+        else {
+          chain.ApplyMove(input, m_rowTotals, first, firstRouter, chain.ScoreMove(input, m_rowTotals, first, firstRouter));
+        }
+      }
+      else {
+        size_t host = chain.rng() % input.hosts;
+        size_t to = ProposeRouter(chain, host);
+        if (to == chain.membership[host]) {
+          continue;
+        }
+        double energy = chain.ScoreMove(input, m_rowTotals, host, to);
+        if (Accept(chain, energy - chain.energy, temperature)) {
+          chain.ApplyMove(input, m_rowTotals, host, to, energy);
+        }
+      }
+
+      if (chain.energy < chain.bestEnergy) {
+        chain.bestEnergy = chain.energy;
+        chain.bestMembership = chain.membership;
+        chain.bestTypes = chain.types;
+      }
+    }
+  }
+
+  /**
+   * Metropolis criterion for a move changing energy of the chain by delta.
+   */
+  static bool Accept(Chain& chain, double delta, double temperature) {
+    if (delta <= 0.0 || chain.dist(chain.rng) < std::exp(-delta / temperature)) {
+      ++chain.accepted;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Returns a random router the host may use.
+   */
+  size_t ProposeRouter(Chain& chain, size_t host) const {
+    return m_input.candidates.IsEmpty() ? chain.rng() % m_input.routers : m_input.candidates.Get(host)[chain.rng() % m_input.candidates.count];
+  }
+
+  bool IsCandidate(size_t host, size_t router) const {
+    return m_input.candidates.IsEmpty() || std::ranges::find(m_input.candidates.Get(host), router) != m_input.candidates.Get(host).end();
+  }
+
+  /**
+   * Sets the initial temperature so that an average uphill move from the initial states is accepted with the initial acceptance.
+   */
+  double CalibrateTemperature() {
+    constexpr size_t kSamples = 256;
+    double sum = 0.0;
+    size_t count = 0;
+    for (auto& chain : m_chains) {
+      for (size_t i = 0; i < kSamples / m_chains.size() + 1 && m_input.hosts != 0 && m_input.routers > 1; ++i) {
+        size_t host = chain.rng() % m_input.hosts;
+        size_t to = ProposeRouter(chain, host);
+        if (to == chain.membership[host]) {
+          continue;
+        }
+        double delta = chain.ScoreMove(m_input, m_rowTotals, host, to) - chain.energy;
+        if (delta > 0.0) {
+          sum += delta;
+          ++count;
+        }
+      }
+    }
+
+    if (count == 0 || sum == 0.0) {
+      return 1.0;
+    }
+    return -(sum / count) / std::log(std::clamp(m_options.initialAcceptance, 1e-6, 1.0 - 1e-6));
+  }
+
+  /**
+   * Restarts the chains with the highest current energy from the best state.
+   */
+  void ReplaceWorstChains() {
+    const size_t replaced = std::min(m_options.replacedChains, m_chains.size());
+    m_order.resize(m_chains.size());
+    for (size_t i = 0; i < m_order.size(); ++i) {
+      m_order[i] = i;
+    }
+    std::ranges::partial_sort(m_order, m_order.begin() + replaced, [&](size_t lhs, size_t rhs) {
+      return m_chains[lhs].energy > m_chains[rhs].energy;
+    });
+    for (size_t i = 0; i < replaced; ++i) {
+      m_chains[m_order[i]].Reset(m_input, m_bestMembership, m_bestTypes);
+    }
+  }
+
+  void UpdateBest() {
+    for (const auto& chain : m_chains) {
+      if (chain.bestEnergy < m_bestEnergy || m_bestMembership.empty()) {
+        m_bestEnergy = chain.bestEnergy;
+        m_bestMembership = chain.bestMembership;
+        m_bestTypes = chain.bestTypes;
+      }
+    }
+  }
+
+  const TopologyInput& m_input;
+  Options m_options;
+  /// Traffic from each host to all hosts.
+  std::vector<size_t> m_rowTotals;
+  std::vector<Chain> m_chains;
+  /// Chain indices by descending energy, scratch of ReplaceWorstChains.
+  std::vector<size_t> m_order;
+  size_t m_step;
+  double m_initialTemperature;
+  std::vector<size_t> m_bestMembership;
+  std::vector<RouterType> m_bestTypes;
+  double m_bestEnergy;
+};
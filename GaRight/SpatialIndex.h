@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Host.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * Static 2-d tree over points. Built once in O(N log N), nearest neighbour queries take O(log N + k) on average.
+ * Nodes are implicit: the median of every index range is its root, split axis alternates with depth.
+ */
+struct KdTree final {
+  explicit KdTree(const std::vector<Switch>& points)
+    : m_points(points)
+    , m_order(points.size()) {
+    std::iota(m_order.begin(), m_order.end(), static_cast<size_t>(0));
+    Build(0, m_order.size(), 0);
+  }
+
+  /**
+   * Writes indices of k nearest points to result, nearest first.
+   */
+  void FindNearest(float x, float y, size_t k, std::vector<size_t>& result) const {
+    result.clear();
+    k = std::min(k, m_points.size());
+    if (k == 0) {
+      return;
+    }
+
+    // Max-heap of the best k candidates by squared distance
+    std::priority_queue<std::pair<float, size_t>> best;
+    Search(0, m_order.size(), 0, x, y, k, best);
+
+    result.resize(best.size());
+    for (size_t i = result.size(); i-- > 0;) {
+      result[i] = best.top().second;
+      best.pop();
+    }
+  }
+
+private:
+  static float Coordinate(const Switch& point, size_t axis) {
+    return axis == 0 ? point.GetX() : point.GetY();
+  }
+
+  void Build(size_t first, size_t last, size_t depth) {
+    if (last - first <= 1) {
+      return;
+    }
+
+    size_t axis = depth % 2;
+    size_t middle = first + (last - first) / 2;
+    std::nth_element(m_order.begin() + first, m_order.begin() + middle, m_order.begin() + last, [&](size_t lhs, size_t rhs) {
+      return Coordinate(m_points[lhs], axis) < Coordinate(m_points[rhs], axis);
+    });
+    Build(first, middle, depth + 1);
+    Build(middle + 1, last, depth + 1);
+  }
+
+  void Search(size_t first, size_t last, size_t depth, float x, float y, size_t k, std::priority_queue<std::pair<float, size_t>>& best) const {
+    if (first >= last) {
+      return;
+    }
+
+    size_t axis = depth % 2;
+    size_t middle = first + (last - first) / 2;
+    const Switch& point = m_points[m_order[middle]];
+    float dx = point.GetX() - x;
+    float dy = point.GetY() - y;
+    float distance = dx * dx + dy * dy;
+    if (best.size() < k) {
+      best.emplace(distance, m_order[middle]);
+    }
+    else if (distance < best.top().first) {
+      best.pop();
+      best.emplace(distance, m_order[middle]);
+    }
+
+    // Visit the side of the query point first, the other one only if the splitting plane is closer than the worst candidate
+    float delta = (axis == 0 ? x : y) - Coordinate(point, axis);
+    bool left = delta < 0.0f;
+    Search(left ? first : middle + 1, left ? middle : last, depth + 1, x, y, k, best);
+    if (best.size() < k || delta * delta < best.top().first) {
+      Search(left ? middle + 1 : first, left ? last : middle, depth + 1, x, y, k, best);
+    }
+  }
+
+  const std::vector<Switch>& m_points;
+  std::vector<size_t> m_order;
+};
+
+/// Nearest candidate routers of each host. Empty table allows every router.
+struct CandidateTable final {
+  /// Candidates per host.
+  size_t count = 0;
+  /// [host x count] candidate routers, nearest first.
+  std::vector<size_t> routers;
+
+  bool IsEmpty() const {
+    return count == 0;
+  }
+
+  std::span<const size_t> Get(size_t host) const {
+    return { routers.data() + host * count, count };
+  }
+
+  /**
+   * Finds count nearest routers of every host.
+   */
+  static CandidateTable Create(const std::vector<Host>& hosts, const std::vector<Switch>& switches, size_t count) {
+    CandidateTable result;
+    result.count = std::min(count, switches.size());
+    result.routers.reserve(hosts.size() * result.count);
+
+    KdTree tree(switches);
+    std::vector<size_t> nearest;
+    for (const auto& host : hosts) {
+      tree.FindNearest(host.GetX(), host.GetY(), result.count, nearest);
+      result.routers.insert(result.routers.end(), nearest.begin(), nearest.end());
+    }
+
+    return result;
+  }
+};
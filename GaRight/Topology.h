@@ -1,50 +1,24 @@
 #pragma once
 
+#include "FixedRouterKernels.h"
 #include "Matrix.h"
+#include "Parallel.h"
+#include "ParallelEvaluator.h"
 #include "TopologyGenerator.h"
+#include "TopologyInput.h"
+#include "TrafficDelta.h"
 
-#include <numeric>
-#include <random>
-#include <set>
-
-struct TopologyRandom final {
-  std::mt19937_64 rng;
-  std::uniform_real_distribution<double> dist;
-};
-
-/// Pre-generated topology data.
-struct TopologyInput final {
-  /// Hosts count.
-  size_t hosts;
-  /// Routers count.
-  size_t routers;
-  /// Table of routers' ports count.
-  std::vector<size_t> portsCount;
-  /// Matrix of single-sided traffic between hosts.
-  Matrix<size_t> trafficMatrix;
-  /// Symmetrical matrix of bandwidth of channels between routers.
-  SymmetricalMatrix<size_t> bandwidthMatrix;
-
-  friend std::ostream& operator<<(std::ostream& os, const TopologyInput& input) {
-    os << "Ports: " << std::accumulate(input.portsCount.begin(), input.portsCount.end(), static_cast<size_t>(0), std::plus()) << '\n';
-    for (size_t i = 0; i < input.portsCount.size(); ++i) {
-      os << "  [" << i << "]: " << input.portsCount[i] << "\n";
-    }
-    os << "Traffic:\n";
-    os << input.trafficMatrix;
-    os << "Bandwidth:\n";
-    os << input.bandwidthMatrix;
-
-    return os;
-  }
-};
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <vector>
 
 /// Topology configuration. (Chromosome)
 struct TopologyConfiguration final {
   /// Table of default gateway for each host.
   std::vector<size_t> membershipTable;
-  /// Table of hosts of each router. (Inverse of membershipTable)
-  std::vector<std::set<size_t>> subnetworkTable;
+  /// Table of sorted hosts of each router. (Inverse of membershipTable)
+  std::vector<std::vector<size_t>> subnetworkTable;
   /// Table of router types.
   std::vector<RouterType> routerTypeTable;
   /// Symmetrical matrix of two-sided channel load.
@@ -76,94 +50,159 @@ struct TopologyConfiguration final {
   }
 
   static TopologyConfiguration CreateRandom(const TopologyInput& input, TopologyRandom& random) {
-    auto membershipTable = TopologyGenerator::CreateMembershipTable(input.hosts, input.routers, random.rng);
-    auto subnetworkTable = TopologyGenerator::CreateSubnetworkTable(input.hosts, input.routers, membershipTable);
+    auto membershipTable = TopologyGenerator::CreateMembershipTable(input.hosts, input.routers, input.portsCount, input.candidates, random.rng);
     auto routerTypeTable = TopologyGenerator::CreateRouterTypeTable(input.routers, random.rng);
-    auto channelLoadMatrix = TopologyGenerator::CreateLoadMatrix(input.hosts, input.routers, { input.trafficMatrix, subnetworkTable, routerTypeTable });
 
-    return TopologyConfiguration {
+    TopologyConfiguration result {
       std::move(membershipTable),
-      std::move(subnetworkTable),
+      {},
       std::move(routerTypeTable),
-      std::move(channelLoadMatrix)
+      SymmetricalMatrix<size_t>(input.routers)
+    };
+    result.Update(input);
+    return result;
+  }
+
+  /**
+   * Creates configuration from a host partition. Each host is moved to a random router with the given probability,
+   * router types are random. Repair only fixes ports, so the partition must already keep hosts on their candidates.
+   */
+  static TopologyConfiguration CreateSeeded(const TopologyInput& input, TopologyRandom& random, const std::vector<size_t>& partition, double perturbation) {
+    TopologyConfiguration result {
+      partition,
+      {},
+      TopologyGenerator::CreateRouterTypeTable(input.routers, random.rng),
+      SymmetricalMatrix<size_t>(input.routers)
     };
+    MutateTables(input, perturbation, random, result);
+    RepairTables(input, random, result);
+    result.Update(input);
+    return result;
   }
 
   static TopologyConfiguration Cross(const TopologyInput& input, const TopologyConfiguration& lhs, const TopologyConfiguration& rhs, TopologyRandom& random) {
-    // Cross membership table (Uniform crossover)
-    std::vector<size_t> membershipTable;
-    membershipTable.reserve(input.hosts);
+    TopologyConfiguration result;
+    CrossTables(input, lhs, rhs, random, result);
+    RepairTables(input, random, result);
+    result.Update(input);
+    return result;
+  }
+
+  static TopologyConfiguration Mutate(const TopologyInput& input, double probability, const TopologyConfiguration& conf, TopologyRandom& random) {
+    TopologyConfiguration result = conf;
+    MutateTables(input, probability, random, result);
+    RepairTables(input, random, result);
+    result.Update(input);
+    return result;
+  }
+
+  /**
+   * Writes uniform crossover of membership and router type tables into result. Reuses buffers of result.
+   * Derived tables of result are left stale until Update.
+   */
+  static void CrossTables(const TopologyInput& input, const TopologyConfiguration& lhs, const TopologyConfiguration& rhs, TopologyRandom& random, TopologyConfiguration& result) {
+    assert(&result != &lhs && &result != &rhs);
 
+    // Cross membership table (Uniform crossover)
+    result.membershipTable.resize(input.hosts);
     for (size_t i = 0; i < input.hosts; ++i) {
       if (random.dist(random.rng) > 0.5) {
-        membershipTable.emplace_back(lhs.membershipTable.at(i));
+        result.membershipTable[i] = lhs.membershipTable.at(i);
       }
       else {
-        membershipTable.emplace_back(rhs.membershipTable.at(i));
+        result.membershipTable[i] = rhs.membershipTable.at(i);
       }
     }
 
     // Cross router type table (Uniform crossover)
-    std::vector<RouterType> routerTypeTable;
-    routerTypeTable.reserve(input.routers);
-
+    result.routerTypeTable.resize(input.routers);
     for (size_t i = 0; i < input.routers; ++i) {
       if (random.dist(random.rng) > 0.5) {
-        routerTypeTable.emplace_back(lhs.routerTypeTable.at(i));
+        result.routerTypeTable[i] = lhs.routerTypeTable.at(i);
       }
       else {
-        routerTypeTable.emplace_back(rhs.routerTypeTable.at(i));
+        result.routerTypeTable[i] = rhs.routerTypeTable.at(i);
       }
     }
-
-    // Create new configuration
-    auto subnetworkTable = TopologyGenerator::CreateSubnetworkTable(input.hosts, input.routers, membershipTable);
-    auto loadMatrix = TopologyGenerator::CreateLoadMatrix(input.hosts, input.routers, {
-        input.trafficMatrix,
-        subnetworkTable,
-        routerTypeTable
-      });
-
-    return TopologyConfiguration {
-      std::move(membershipTable),
-      std::move(subnetworkTable),
-      std::move(routerTypeTable),
-      std::move(loadMatrix)
-    };
   }
 
-  static TopologyConfiguration Mutate(const TopologyInput& input, double probability, const TopologyConfiguration& conf, TopologyRandom& random) {
+  /**
+   * Mutates membership and router type tables in place.
+   * Derived tables are left stale until Update.
+   */
+  static void MutateTables(const TopologyInput& input, double probability, TopologyRandom& random, TopologyConfiguration& conf) {
     // Mutate membership table
-    std::vector<size_t> membershipTable = conf.membershipTable;
-
     for (size_t i = 0; i < input.hosts; ++i) {
       if (random.dist(random.rng) <= probability) {
-        membershipTable[i] = random.rng() % input.routers;
+        conf.membershipTable[i] = input.candidates.IsEmpty()
+          ? random.rng() % input.routers
+          : input.candidates.Get(i)[random.rng() % input.candidates.count];
       }
     }
 
     // Mutate router type table
-    std::vector<RouterType> routerTypeTable = conf.routerTypeTable;
-
     for (size_t i = 0; i < input.routers; ++i) {
       if (random.dist(random.rng) <= probability) {
-        routerTypeTable[i] = static_cast<RouterType>(random.rng() % static_cast<size_t>(RouterType::COUNT));
+        conf.routerTypeTable[i] = static_cast<RouterType>(random.rng() % static_cast<size_t>(RouterType::COUNT));
       }
     }
+  }
 
-    // Create new configuration
-    auto subnetworkTable = TopologyGenerator::CreateSubnetworkTable(input.hosts, input.routers, membershipTable);
-    auto loadMatrix = TopologyGenerator::CreateLoadMatrix(input.hosts, input.routers, {
-        input.trafficMatrix,
-        subnetworkTable,
-        routerTypeTable
-      });
+  /**
+   * Moves hosts out of over-subscribed routers.
+   */
+  static void RepairTables(const TopologyInput& input, TopologyRandom& random, TopologyConfiguration& conf) {
+    TopologyGenerator::RepairBuffers buffers;
+    RepairTables(input, random, buffers, conf);
+  }
 
-    return TopologyConfiguration {
-      std::move(membershipTable),
-      std::move(subnetworkTable),
-      std::move(routerTypeTable),
-      std::move(loadMatrix)
+  static void RepairTables(const TopologyInput& input, TopologyRandom& random, TopologyGenerator::RepairBuffers& buffers, TopologyConfiguration& conf) {
+    TopologyGenerator::RepairMembershipTable(input.hosts, input.routers, { input.trafficMatrix, input.portsCount, input.candidates }, conf.membershipTable, random.rng, buffers);
+  }
+
+  /**
+   * Updates load matrix after the traffic matrix changed by delta. Takes O(routers) per changed entry instead of a full rebuild:
+   * traffic(h1, h2) of a switch a = gateway(h1) only loads the channel to b = gateway(h2), of a hub - every channel of a.
+   */
+  void ApplyTrafficDelta(const TopologyInput& input, const TrafficDelta& delta) {
+    auto add = [&](size_t row, size_t col, int64_t value) {
+      channelLoadMatrix.At(row, col) += static_cast<size_t>(value);
+      channelLoadMatrix.At(col, row) += static_cast<size_t>(value);
     };
+
+    for (const auto& change : delta.changes) {
+      size_t from = membershipTable[change.source];
+      size_t to = membershipTable[change.destination];
+      if (routerTypeTable[from] == RouterType::SWITCH) {
+        if (from != to) {
+          add(from, to, change.delta);
+        }
+        continue;
+      }
+
+      for (size_t router = 0; router < input.routers; ++router) {
+        if (router != from) {
+          add(from, router, change.delta);
+        }
+      }
+    }
+  }
+
+  /**
+   * Rebuilds subnetwork table and load matrix from membership and router type tables. Reuses buffers.
+   * Load matrix of small router counts is computed by a fixed-size kernel, of large host counts - by all threads.
+   */
+  void Update(const TopologyInput& input) {
+    TopologyGenerator::FillSubnetworkTable(input.hosts, input.routers, membershipTable, subnetworkTable);
+    if (input.hosts >= ParallelEvaluator::kMinHosts) {
+      ParallelEvaluator::FillLoadMatrix(input, membershipTable, routerTypeTable, channelLoadMatrix, Parallel::GetThreadsCount());
+      return;
+    }
+    if (const auto* kernel = FixedRouterKernels::Find(input.routers)) {
+      kernel->fillLoadMatrix(input, membershipTable, routerTypeTable, channelLoadMatrix);
+      return;
+    }
+
+    TopologyGenerator::FillLoadMatrix(input.hosts, input.routers, { input.trafficMatrix, subnetworkTable, routerTypeTable }, channelLoadMatrix);
   }
 };
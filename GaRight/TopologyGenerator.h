@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Matrix.h"
+#include "SpatialIndex.h"
 
+#include <algorithm>
+#include <numeric>
 #include <random>
-#include <set>
+#include <vector>
 
 enum class RouterType {
   /// Routes traffic
@@ -16,10 +19,29 @@ enum class RouterType {
 struct TopologyGenerator final {
   struct LoadOptions final {
     const Matrix<size_t>& trafficMatrix;
-    const std::vector<std::set<size_t>>& subnetworkTable;
+    const std::vector<std::vector<size_t>>& subnetworkTable;
     const std::vector<RouterType>& routerTypeTable;
   };
 
+  struct RepairOptions final {
+    const Matrix<size_t>& trafficMatrix;
+    const std::vector<size_t>& portsCount;
+    /// Restricts target routers of each host when not empty.
+    const CandidateTable& candidates;
+  };
+
+  /// Reusable buffers of RepairMembershipTable.
+  struct RepairBuffers final {
+    /// Symmetric host graph with weights traffic(a, b) + traffic(b, a), see GraphPartitioner::CreateTrafficGraph.
+    /// Must follow the traffic matrix. Empty: affinities are read from the traffic matrix.
+    SparseMatrix<size_t> trafficGraph;
+    std::vector<size_t> hostsCount;
+    std::vector<size_t> order;
+    std::vector<size_t> kept;
+    std::vector<size_t> evicted;
+    std::vector<size_t> affinity;
+  };
+
   static std::vector<size_t> CreateMembershipTable(size_t hosts, size_t routers, std::mt19937_64& rng) {
     std::vector<size_t> result;
     result.reserve(hosts);
@@ -30,20 +52,197 @@ struct TopologyGenerator final {
     return result;
   }
 
-  static std::vector<std::set<size_t>> CreateSubnetworkTable(size_t hosts, size_t routers, const std::vector<size_t>& membershipTable) {
-    std::vector<std::set<size_t>> result(routers);
-    // Membership table -> LAN vector
+  /**
+   * Generates membership table which respects ports count of routers.
+   * Hosts that don't fit into the total number of ports get uniformly random gateways.
+   */
+  static std::vector<size_t> CreateMembershipTable(size_t hosts, size_t routers, const std::vector<size_t>& portsCount, std::mt19937_64& rng) {
+    // Pick a random free port for every host
+    std::vector<size_t> result;
+    result.reserve(std::max(hosts, std::accumulate(portsCount.begin(), portsCount.end(), static_cast<size_t>(0), std::plus())));
     for (size_t i = 0; i < routers; ++i) {
-      for (size_t j = 0; j < hosts; ++j) {
-        if (membershipTable[j] == i) {
-          result[i].emplace(j);
+      result.insert(result.end(), portsCount[i], i);
+    }
+    std::ranges::shuffle(result, rng);
+
+    result.resize(std::min(result.size(), hosts));
+    while (result.size() < hosts) {
+      result.emplace_back(rng() % routers);
+    }
+
+    return result;
+  }
+
+  /**
+   * Generates membership table which respects ports count of routers and picks gateways among candidate routers of each host.
+   * A host whose candidates are all full gets a random router with free ports.
+   */
+  static std::vector<size_t> CreateMembershipTable(size_t hosts, size_t routers, const std::vector<size_t>& portsCount, const CandidateTable& candidates, std::mt19937_64& rng) {
+    if (candidates.IsEmpty()) {
+      return CreateMembershipTable(hosts, routers, portsCount, rng);
+    }
+
+    std::vector<size_t> freePorts = portsCount;
+    std::vector<size_t> order(hosts);
+    std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+    std::ranges::shuffle(order, rng);
+
+    std::vector<size_t> result(hosts);
+    std::vector<size_t> options;
+    for (size_t host : order) {
+      options.clear();
+      for (size_t router : candidates.Get(host)) {
+        if (freePorts[router] > 0) {
+          options.emplace_back(router);
         }
       }
+
+      if (options.empty()) {
+        for (size_t router = 0; router < routers; ++router) {
+          if (freePorts[router] > 0) {
+            options.emplace_back(router);
+          }
+        }
+      }
+
+      if (options.empty()) {
+        // Out of ports
+        result[host] = candidates.Get(host)[rng() % candidates.count];
+        continue;
+      }
+
+      result[host] = options[rng() % options.size()];
+      --freePorts[result[host]];
     }
 
     return result;
   }
 
+  /**
+   * Moves excess hosts from over-subscribed routers to under-subscribed ones.
+   * Evicted hosts are chosen randomly, each goes to the free router it exchanges the most traffic with.
+   * Candidate routers of the host are preferred, other routers are used only if all candidates are full.
+   * Takes O(hosts * evicted), O((degree + routers) * evicted) with the traffic graph in buffers.
+   * Hosts stay over-subscribed only when there are no free ports left.
+   */
+  static void RepairMembershipTable(size_t hosts, size_t routers, const RepairOptions& options, std::vector<size_t>& membershipTable, std::mt19937_64& rng) {
+    RepairBuffers buffers;
+    RepairMembershipTable(hosts, routers, options, membershipTable, rng, buffers);
+  }
+
+  /**
+   * Same as above, reuses buffers between calls.
+   */
+  static void RepairMembershipTable(size_t hosts, size_t routers, const RepairOptions& options, std::vector<size_t>& membershipTable, std::mt19937_64& rng, RepairBuffers& buffers) {
+    std::vector<size_t>& hostsCount = buffers.hostsCount;
+    hostsCount.assign(routers, 0);
+    for (size_t i = 0; i < hosts; ++i) {
+      ++hostsCount[membershipTable[i]];
+    }
+
+    bool oversubscribed = false;
+    for (size_t i = 0; i < routers; ++i) {
+      oversubscribed |= hostsCount[i] > options.portsCount[i];
+    }
+    if (!oversubscribed) {
+      return;
+    }
+
+    // Keep random hosts of each router up to its ports count
+    std::vector<size_t>& order = buffers.order;
+    order.resize(hosts);
+    std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+    std::ranges::shuffle(order, rng);
+
+    std::vector<size_t>& kept = buffers.kept;
+    std::vector<size_t>& evicted = buffers.evicted;
+    kept.assign(routers, 0);
+    evicted.clear();
+    for (size_t host : order) {
+      size_t router = membershipTable[host];
+      if (kept[router] < options.portsCount[router]) {
+        ++kept[router];
+      }
+      else {
+        evicted.emplace_back(host);
+      }
+    }
+
+    // Move each evicted host to the free router with the most local traffic
+    const SparseMatrix<size_t>& graph = buffers.trafficGraph;
+    const bool useGraph = graph.GetHeight() == hosts;
+    std::vector<size_t>& affinity = buffers.affinity;
+    affinity.resize(routers);
+    for (size_t host : evicted) {
+      size_t from = membershipTable[host];
+      std::ranges::fill(affinity, 0);
+      if (useGraph) {
+        // Only peers the host exchanges traffic with. Self traffic counts only for its full router, which is never chosen
+        for (size_t i = graph.GetOffsets()[host]; i < graph.GetOffsets()[host + 1]; ++i) {
+          affinity[membershipTable[graph.GetColumns()[i]]] += graph.GetValues()[i];
+        }
+      }
+      else {
+        for (size_t other = 0; other < hosts; ++other) {
+          affinity[membershipTable[other]] += options.trafficMatrix.At(host, other) + options.trafficMatrix.At(other, host);
+        }
+      }
+
+      size_t best = routers;
+      auto consider = [&](size_t i) {
+        if (hostsCount[i] >= options.portsCount[i]) {
+          return;
+        }
+
+        if (best == routers
+          || affinity[i] > affinity[best]
+          || (affinity[i] == affinity[best] && options.portsCount[i] - hostsCount[i] > options.portsCount[best] - hostsCount[best])) {
+          best = i;
+        }
+      };
+
+      if (!options.candidates.IsEmpty()) {
+        for (size_t i : options.candidates.Get(host)) {
+          consider(i);
+        }
+      }
+      if (best == routers) {
+        for (size_t i = 0; i < routers; ++i) {
+          consider(i);
+        }
+      }
+
+      if (best == routers) {
+        // No free ports left
+        break;
+      }
+
+      membershipTable[host] = best;
+      --hostsCount[from];
+      ++hostsCount[best];
+    }
+  }
+
+  static std::vector<std::vector<size_t>> CreateSubnetworkTable(size_t hosts, size_t routers, const std::vector<size_t>& membershipTable) {
+    std::vector<std::vector<size_t>> result;
+    FillSubnetworkTable(hosts, routers, membershipTable, result);
+    return result;
+  }
+
+  /**
+   * Membership table -> LAN vector. Hosts of each router are sorted. Reuses capacity of result.
+   */
+  static void FillSubnetworkTable(size_t hosts, size_t routers, const std::vector<size_t>& membershipTable, std::vector<std::vector<size_t>>& result) {
+    result.resize(routers);
+    for (auto& subnetwork : result) {
+      subnetwork.clear();
+    }
+
+    for (size_t i = 0; i < hosts; ++i) {
+      result[membershipTable[i]].emplace_back(i);
+    }
+  }
+
   static std::vector<RouterType> CreateRouterTypeTable(size_t routers, std::mt19937_64& rng) {
     std::vector<RouterType> result;
     result.reserve(routers);
@@ -56,10 +255,24 @@ struct TopologyGenerator final {
   }
 
   static SymmetricalMatrix<size_t> CreateLoadMatrix(size_t hosts, size_t routers, const LoadOptions& options) {
-    SymmetricalMatrix<size_t> loadMatrix(routers);
+    SymmetricalMatrix<size_t> loadMatrix;
+    FillLoadMatrix(hosts, routers, options, loadMatrix);
+    return loadMatrix;
+  }
+
+  /**
+   * Same as above, reuses storage of loadMatrix if it has the right size.
+   */
+  static void FillLoadMatrix(size_t hosts, size_t routers, const LoadOptions& options, SymmetricalMatrix<size_t>& loadMatrix) {
+    if (loadMatrix.GetWidth() == routers) {
+      loadMatrix.Fill(0);
+    }
+    else {
+      loadMatrix = SymmetricalMatrix<size_t>(routers);
+    }
 
     for (size_t router1 = 0; router1 < routers; ++router1) {
-      const std::set<size_t>& set1 = options.subnetworkTable[router1];
+      const std::vector<size_t>& set1 = options.subnetworkTable[router1];
 
       for (size_t router2 = 0; router2 < routers; ++router2) {
         if (router1 == router2) {
@@ -68,7 +281,7 @@ struct TopologyGenerator final {
 
         if (options.routerTypeTable[router1] == RouterType::SWITCH) {
           // Switch routes traffic. Only outer traffic matters.
-          const std::set<size_t>& set2 = options.subnetworkTable[router2];
+          const std::vector<size_t>& set2 = options.subnetworkTable[router2];
 
           for (size_t host1 : set1) {
             for (size_t host2 : set2) {
@@ -86,7 +299,5 @@ struct TopologyGenerator final {
         }
       }
     }
-
-    return loadMatrix;
   }
 };
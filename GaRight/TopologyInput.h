@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Host.h"
+#include "Matrix.h"
+#include "SpatialIndex.h"
+#include "TrafficDelta.h"
+#include "TrafficEpochs.h"
+
+#include <cmath>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <span>
+#include <vector>
+
+struct TopologyRandom final {
+  std::mt19937_64 rng;
+  std::uniform_real_distribution<double> dist;
+};
+
+/// Pre-generated topology data.
+struct TopologyInput final {
+  /// Hosts count.
+  size_t hosts;
+  /// Routers count.
+  size_t routers;
+  /// Table of routers' ports count.
+  std::vector<size_t> portsCount;
+  /// Matrix of single-sided traffic between hosts.
+  Matrix<size_t> trafficMatrix;
+  /// Symmetrical matrix of bandwidth of channels between routers.
+  SymmetricalMatrix<size_t> bandwidthMatrix;
+  /// Positions of hosts. Optional.
+  std::vector<Host> hostUnits;
+  /// Positions of routers. Optional, required if hostUnits is set.
+  std::vector<Switch> routerUnits;
+  /// Nearest routers each host may connect to. Empty allows every router.
+  CandidateTable candidates;
+  /// Weight of the total host-gateway distance in the fitness cost.
+  double distanceWeight = 0.0;
+  /// Traffic of several epochs. trafficMatrix is then their mean. Optional.
+  TrafficEpochs epochs;
+
+  /**
+   * Sets traffic of several epochs. trafficMatrix becomes their mean.
+   */
+  void SetTrafficEpochs(const std::vector<Matrix<size_t>>& matrices, EpochAggregation aggregation, double percentile = 0.9) {
+    trafficMatrix = TrafficEpochs::CreateMeanMatrix(matrices);
+    epochs = TrafficEpochs::Create(matrices, aggregation, percentile);
+  }
+
+  /**
+   * Applies changes of traffic and of its epochs. Configurations evaluated before are then re-scored by the same delta.
+   */
+  void ApplyTrafficDelta(const TrafficDelta& delta) {
+    for (const auto& change : delta.changes) {
+      trafficMatrix.At(change.source, change.destination) += static_cast<size_t>(change.delta);
+    }
+    for (const auto& change : delta.epochChanges) {
+      epochs.traffic[change.index] += static_cast<size_t>(change.delta);
+    }
+  }
+
+  bool HasLayout() const {
+    return !hostUnits.empty();
+  }
+
+  double GetDistance(size_t host, size_t router) const {
+    return std::hypot(hostUnits[host].GetX() - routerUnits[router].GetX(), hostUnits[host].GetY() - routerUnits[router].GetY());
+  }
+
+  /**
+   * Returns total distance between hosts and their gateways. Zero without layout.
+   */
+  double CalculateDistance(std::span<const size_t> membershipTable) const {
+    if (!HasLayout()) {
+      return 0.0;
+    }
+
+    double distance = 0.0;
+    for (size_t i = 0; i < hosts; ++i) {
+      distance += GetDistance(i, membershipTable[i]);
+    }
+
+    return distance;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const TopologyInput& input) {
+    os << "Ports: " << std::accumulate(input.portsCount.begin(), input.portsCount.end(), static_cast<size_t>(0), std::plus()) << '\n';
+    for (size_t i = 0; i < input.portsCount.size(); ++i) {
+      os << "  [" << i << "]: " << input.portsCount[i] << "\n";
+    }
+    os << "Traffic:\n";
+    os << input.trafficMatrix;
+    os << "Bandwidth:\n";
+    os << input.bandwidthMatrix;
+
+    return os;
+  }
+};
@@ -1,5 +1,8 @@
 #pragma once
+#include "CounterRandom.h"
+#include "Host.h"
 #include "Matrix.h"
+#include "Parallel.h"
 
 #include <random>
 
@@ -15,6 +18,16 @@ struct TopologyInputGenerator final {
     size_t offset;
   };
 
+  struct LayoutOptions final {
+    float width;
+    float height;
+  };
+
+  /// Counter-based random streams. Keep traffic and bandwidth independent for the same seed.
+  static constexpr uint32_t kTrafficStream = 0x7472;
+  static constexpr uint32_t kBandwidthStream = 0x6277;
+  static constexpr uint32_t kLayoutStream = 0x6c79;
+
   /**
    * Generates a matrix with one-sided traffic between hosts
    */
@@ -52,4 +65,149 @@ struct TopologyInputGenerator final {
 
     return matrix;
   }
+
+  /**
+   * Generates one-sided traffic between two hosts. Depends only on (seed, row, col).
+   */
+  static size_t CreateTraffic(const CounterRandom& random, const TrafficOptions& options, size_t row, size_t col) {
+    if (row == col) {
+      return 0;
+    }
+
+    auto bits = random.At(row, col);
+    return CounterRandom::ToUnit(bits[0]) > options.nonZeroChance ? 0 : bits[1] % options.amount + options.offset;
+  }
+
+  /**
+   * Generates non-zero traffic of rows [first, last) in order and passes it to visitor(row, col, traffic).
+   * Nothing is stored, so the output can be streamed into any representation.
+   */
+  template <typename Visitor>
+  static void VisitTraffic(size_t hosts, const TrafficOptions& options, uint64_t seed, size_t first, size_t last, Visitor&& visitor) {
+    CounterRandom random(seed, kTrafficStream);
+
+    for (size_t row = first; row < last; ++row) {
+      for (size_t col = 0; col < hosts; ++col) {
+        size_t traffic = CreateTraffic(random, options, row, col);
+        if (traffic != 0) {
+          visitor(row, col, traffic);
+        }
+      }
+    }
+  }
+
+  /**
+   * Generates a matrix with one-sided traffic between hosts on several threads.
+   * The result is bit-identical for any number of threads.
+   */
+  static Matrix<size_t> CreateTrafficMatrix(size_t hosts, const TrafficOptions& options, uint64_t seed, size_t threads) {
+    Matrix<size_t> matrix(hosts, hosts);
+    CounterRandom random(seed, kTrafficStream);
+
+    // Blocks of columns are contiguous in memory
+    Parallel::ForBlocks(hosts, threads, [&](size_t begin, size_t end, size_t) {
+      for (size_t col = begin; col < end; ++col) {
+        for (size_t row = 0; row < hosts; ++row) {
+          matrix(row, col) = CreateTraffic(random, options, row, col);
+        }
+      }
+    });
+
+    return matrix;
+  }
+
+  /**
+   * Generates a sparse matrix with one-sided traffic between hosts on several threads.
+   * Each thread builds its own block of rows, blocks are concatenated in order.
+   */
+  static SparseMatrix<size_t> CreateSparseTrafficMatrix(size_t hosts, const TrafficOptions& options, uint64_t seed, size_t threads) {
+    std::vector<SparseMatrix<size_t>> blocks(std::clamp(threads, static_cast<size_t>(1), std::max(hosts, static_cast<size_t>(1))), SparseMatrix<size_t>(hosts));
+
+    Parallel::ForBlocks(hosts, blocks.size(), [&](size_t begin, size_t end, size_t block) {
+      SparseMatrix<size_t>& matrix = blocks[block];
+      size_t currentRow = begin;
+      VisitTraffic(hosts, options, seed, begin, end, [&](size_t row, size_t col, size_t traffic) {
+        for (; currentRow < row; ++currentRow) {
+          matrix.EndRow();
+        }
+        matrix.PushBack(col, traffic);
+      });
+      for (; currentRow < end; ++currentRow) {
+        matrix.EndRow();
+      }
+    });
+
+    SparseMatrix<size_t> result(hosts);
+    for (const auto& block : blocks) {
+      result.Append(block);
+    }
+
+    return result;
+  }
+
+  /**
+   * Generates a symmetrical matrix with bandwidth of channels between routers. Depends only on seed.
+   */
+  static SymmetricalMatrix<size_t> CreateBandwidthMatrix(size_t routers, const BandwidthOptions& options, uint64_t seed) {
+    SymmetricalMatrix<size_t> matrix(routers);
+    CounterRandom random(seed, kBandwidthStream);
+
+    for (size_t row = 0; row < routers; ++row) {
+      for (size_t col = row + 1; col < routers; ++col) {
+        matrix.Set(row, col, random.At(row, col)[0] % options.amount + options.offset);
+      }
+    }
+
+    return matrix;
+  }
+
+  /**
+   * Places hosts uniformly over the area. Output of a host is its total outgoing traffic.
+   */
+  static std::vector<Host> CreateHostUnits(const Matrix<size_t>& trafficMatrix, const LayoutOptions& options, uint64_t seed) {
+    const size_t hosts = trafficMatrix.GetWidth();
+    CounterRandom random(seed, kLayoutStream);
+
+    std::vector<Host> result;
+    result.reserve(hosts);
+    for (size_t i = 0; i < hosts; ++i) {
+      size_t output = 0;
+      for (size_t j = 0; j < hosts; ++j) {
+        output += trafficMatrix.At(i, j);
+      }
+
+      auto bits = random.At(0, i);
+      result.emplace_back(
+        static_cast<float>(CounterRandom::ToUnit(bits[0]) * options.width),
+        static_cast<float>(CounterRandom::ToUnit(bits[1]) * options.height),
+        output);
+    }
+
+    return result;
+  }
+
+  /**
+   * Places routers uniformly over the area. Bandwidth of a router is the total bandwidth of its channels.
+   */
+  static std::vector<Switch> CreateRouterUnits(const SymmetricalMatrix<size_t>& bandwidthMatrix, const LayoutOptions& options, uint64_t seed) {
+    const size_t routers = bandwidthMatrix.GetWidth();
+    CounterRandom random(seed, kLayoutStream);
+
+    std::vector<Switch> result;
+    result.reserve(routers);
+    for (size_t i = 0; i < routers; ++i) {
+      size_t bandwidth = 0;
+      for (size_t j = 0; j < routers; ++j) {
+        bandwidth += bandwidthMatrix.At(i, j);
+      }
+
+      auto bits = random.At(1, i);
+      result.emplace_back(
+        static_cast<float>(CounterRandom::ToUnit(bits[0]) * options.width),
+        static_cast<float>(CounterRandom::ToUnit(bits[1]) * options.height),
+        bandwidth);
+    }
+
+    return result;
+  }
 };
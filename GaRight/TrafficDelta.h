@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Matrix.h"
+#include "TrafficEpochs.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Changed entries between two traffic matrices of the same hosts, and between their epochs if there are any.
+ */
+struct TrafficDelta final {
+  struct Change final {
+    size_t source;
+    size_t destination;
+    /// New traffic minus previous traffic.
+    int64_t delta;
+  };
+
+  /// Change of a single epoch entry.
+  struct EpochChange final {
+    /// Index into TrafficEpochs::traffic.
+    size_t index;
+    int64_t delta;
+  };
+
+  /// Changes of the traffic matrix. Loads are updated by them.
+  std::vector<Change> changes;
+  /// Changes of epochs. Per-epoch objectives are evaluated from epochs, so they must follow the traffic matrix.
+  std::vector<EpochChange> epochChanges;
+
+  bool IsEmpty() const {
+    return changes.empty() && epochChanges.empty();
+  }
+
+  static TrafficDelta Create(const Matrix<size_t>& previous, const Matrix<size_t>& current) {
+    assert(previous.GetWidth() == current.GetWidth() && previous.GetHeight() == current.GetHeight());
+    TrafficDelta result;
+    for (size_t col = 0; col < current.GetHeight(); ++col) {
+      for (size_t row = 0; row < current.GetWidth(); ++row) {
+        size_t before = previous.At(row, col);
+        size_t after = current.At(row, col);
+        if (before != after) {
+          result.changes.emplace_back(Change { row, col, static_cast<int64_t>(after) - static_cast<int64_t>(before) });
+        }
+      }
+    }
+
+    return result;
+  }
+
+  /**
+   * Same as above, also collects changes between epochs of the same count. Traffic matrices are the means of epochs.
+   */
+  static TrafficDelta Create(const Matrix<size_t>& previous, const Matrix<size_t>& current, const TrafficEpochs& previousEpochs, const TrafficEpochs& currentEpochs) {
+    assert(previousEpochs.count == currentEpochs.count && previousEpochs.traffic.size() == currentEpochs.traffic.size());
+    TrafficDelta result = Create(previous, current);
+    for (size_t i = 0; i < currentEpochs.traffic.size(); ++i) {
+      size_t before = previousEpochs.traffic[i];
+      size_t after = currentEpochs.traffic[i];
+      if (before != after) {
+        result.epochChanges.emplace_back(EpochChange { i, static_cast<int64_t>(after) - static_cast<int64_t>(before) });
+      }
+    }
+
+    return result;
+  }
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Matrix.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <span>
+#include <vector>
+
+/// How objectives of several traffic epochs are combined.
+enum class EpochAggregation {
+  /**
+   * Rounded mean of per-epoch objectives. Traffic difference |2 * load - bandwidth| is not linear, so it's evaluated per epoch.
+   * Total traffic is linear, it's taken from the mean traffic matrix at once.
+   */
+  MEAN,
+  /// Objectives of the worst epoch.
+  WORST,
+  /// Objectives at a percentile of epochs.
+  PERCENTILE
+};
+
+/**
+ * Traffic matrices of several epochs (e.g. day, night, peak) stored interleaved,
+ * so evaluation reads all epochs of a host pair in one traversal.
+ */
+struct TrafficEpochs final {
+  /// Epochs count. Zero or one means a single traffic matrix.
+  size_t count = 0;
+  /// [col x host x epoch] traffic(host, col) of every epoch.
+  std::vector<size_t> traffic;
+  EpochAggregation aggregation = EpochAggregation::MEAN;
+  /// Used by EpochAggregation::PERCENTILE, in [0, 1].
+  double percentile = 0.9;
+
+  /**
+   * True if objectives must be evaluated per epoch, i.e. there are several epochs.
+   */
+  bool IsPerEpoch() const {
+    return count > 1;
+  }
+
+  /**
+   * True if total traffic is aggregated from epochs. Mean total traffic is that of the mean traffic matrix.
+   */
+  bool IsTrafficPerEpoch() const {
+    return IsPerEpoch() && aggregation != EpochAggregation::MEAN;
+  }
+
+  /**
+   * Combines per-epoch values. Reorders values.
+   */
+  size_t Aggregate(std::span<size_t> values) const {
+    assert(!values.empty());
+    switch (aggregation) {
+      case EpochAggregation::MEAN: {
+        size_t sum = 0;
+        for (size_t value : values) {
+          sum += value;
+        }
+        return (sum + values.size() / 2) / values.size();
+      }
+      case EpochAggregation::WORST:
+        return *std::ranges::max_element(values);
+      case EpochAggregation::PERCENTILE: {
+        size_t rank = static_cast<size_t>(std::ceil(percentile * values.size()));
+        auto nth = values.begin() + (std::clamp<size_t>(rank, 1, values.size()) - 1);
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+      }
+    }
+
+    assert(false);
+    return 0;
+  }
+
+  /**
+   * Extracts traffic matrix of a single epoch.
+   */
+  Matrix<size_t> CreateMatrix(size_t epoch, size_t hosts) const {
+    assert(epoch < count && traffic.size() == hosts * hosts * count);
+    Matrix<size_t> result(hosts, hosts);
+    std::vector<size_t> data(hosts * hosts);
+    for (size_t cell = 0; cell < data.size(); ++cell) {
+      data[cell] = traffic[cell * count + epoch];
+    }
+    result.Assign(data);
+    return result;
+  }
+
+  /**
+   * Interleaves square traffic matrices of the same size.
+   */
+  static TrafficEpochs Create(const std::vector<Matrix<size_t>>& matrices, EpochAggregation aggregation, double percentile) {
+    TrafficEpochs result;
+    result.count = matrices.size();
+    result.aggregation = aggregation;
+    result.percentile = percentile;
+    if (matrices.empty()) {
+      return result;
+    }
+
+    const size_t cells = matrices.front().GetData().size();
+    result.traffic.resize(cells * result.count);
+    for (size_t epoch = 0; epoch < result.count; ++epoch) {
+      assert(matrices[epoch].GetData().size() == cells);
+      const auto& data = matrices[epoch].GetData();
+      for (size_t cell = 0; cell < cells; ++cell) {
+        result.traffic[cell * result.count + epoch] = data[cell];
+      }
+    }
+
+    return result;
+  }
+
+  /**
+   * Rounded element-wise mean of matrices.
+   */
+  static Matrix<size_t> CreateMeanMatrix(const std::vector<Matrix<size_t>>& matrices) {
+    assert(!matrices.empty());
+    Matrix<size_t> result(matrices.front().GetWidth(), matrices.front().GetHeight());
+    std::vector<size_t> sums(result.GetData().size(), 0);
+    for (const auto& matrix : matrices) {
+      const auto& data = matrix.GetData();
+      for (size_t cell = 0; cell < sums.size(); ++cell) {
+        sums[cell] += data[cell];
+      }
+    }
+
+    for (size_t& sum : sums) {
+      sum = (sum + matrices.size() / 2) / matrices.size();
+    }
+    result.Assign(sums);
+    return result;
+  }
+};
@@ -0,0 +1,43 @@
+#include <GaRight/ProgressTrace.h>
+
+#include <fstream>
+#include <iostream>
+
+// Decodes a binary progress trace written by GaRight into comma-separated text.
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: TraceDecoder <trace file> [output file]\n";
+    return 1;
+  }
+
+  std::ifstream input(argv[1], std::ios::binary);
+  if (!input) {
+    std::cerr << "Can't open " << argv[1] << '\n';
+    return 1;
+  }
+
+  std::ofstream file;
+  if (argc > 2) {
+    file.open(argv[2]);
+  }
+  std::ostream& output = argc > 2 ? file : std::cout;
+
+  ProgressTraceHeader header {};
+  output << "generation,time_ms,best_fitness,mean_fitness,difference,port_penalty,traffic\n";
+  bool valid = ProgressTraceReader::Read(input, header, [&output](const ProgressRecord& record) {
+    output << record.generation << ','
+      << static_cast<double>(record.timestamp) / 1e6 << ','
+      << record.bestFitness << ','
+      << record.meanFitness << ','
+      << record.trafficDifference << ','
+      << record.portPenalty << ','
+      << record.traffic << '\n';
+  });
+
+  if (!valid) {
+    std::cerr << argv[1] << " is not a progress trace\n";
+    return 1;
+  }
+
+  return 0;
+}